@@ -0,0 +1,152 @@
+// === Includes ===
+#include "alloc.h"
+#include <stdlib.h>
+#include <string.h>
+#include "mongoose.h"
+
+// === Pools ===
+// Every block starts with a header naming its pool, so mg_free needs no size.
+// Pool i hands out blocks of ALLOC_MIN_SIZE << i bytes after the header.
+#define ALLOC_HEADER_SIZE 16
+#define ALLOC_MIN_SIZE 64
+#define ALLOC_LARGE 0xff
+
+typedef struct PoolBlock {
+	struct PoolBlock* next;	// only while on a free list
+	u8 pool;
+} PoolBlock;
+
+#define ALLOC_POOL_COUNT 16
+
+static PoolBlock* pools[ALLOC_POOL_COUNT];	// free lists
+static u64 heap_count;
+
+static u64 alloc_pool_size(i32 index) {
+	return (u64)ALLOC_MIN_SIZE << index;
+}
+
+static i32 alloc_pool_for(u64 size) {
+	i32 index = 0;
+	while (index < ALLOC_POOL_COUNT && alloc_pool_size(index) < size)
+		index++;
+	return index < ALLOC_POOL_COUNT && alloc_pool_size(index) <= ALLOC_POOL_MAX_SIZE ? index : -1;
+}
+
+// Carve a fresh slab into blocks for an empty pool.
+static bool alloc_refill(i32 index) {
+	u64 stride = ALLOC_HEADER_SIZE + alloc_pool_size(index);
+	u64 count = ALLOC_SLAB_SIZE / stride;
+	if (count == 0)
+		count = 1;
+	u8* slab = malloc(count * stride);
+	if (!slab)
+		return false;
+	heap_count++;
+	for (u64 i = 0; i < count; ++i) {
+		PoolBlock* block = (PoolBlock*)(slab + i * stride);
+		block->pool = (u8)index;
+		block->next = pools[index];
+		pools[index] = block;
+	}
+	return true;
+}
+
+void* mg_calloc(size_t count, size_t size) {
+	if (size != 0 && count > (size_t)-1 / size)
+		return NULL;
+	u64 total = (u64)count * size;
+	i32 index = alloc_pool_for(total);
+	PoolBlock* block;
+	if (index < 0) {
+		block = calloc(1, ALLOC_HEADER_SIZE + total);
+		if (!block)
+			return NULL;
+		heap_count++;
+		block->pool = ALLOC_LARGE;
+		return (u8*)block + ALLOC_HEADER_SIZE;
+	}
+	if (!pools[index] && !alloc_refill(index))
+		return NULL;
+	block = pools[index];
+	pools[index] = block->next;
+	u8* p = (u8*)block + ALLOC_HEADER_SIZE;
+	memset(p, 0, total);
+	return p;
+}
+
+void mg_free(void* ptr) {
+	if (!ptr)
+		return;
+	PoolBlock* block = (PoolBlock*)((u8*)ptr - ALLOC_HEADER_SIZE);
+	if (block->pool == ALLOC_LARGE) {
+		free(block);
+		return;
+	}
+	block->next = pools[block->pool];
+	pools[block->pool] = block;
+}
+
+u64 alloc_heap_count(void) {
+	return heap_count;
+}
+
+// === Arenas ===
+struct ArenaChunk {
+	ArenaChunk* next;
+	u64 pad;	// keeps data 16-byte aligned
+	u8 data[];
+};
+
+#define ARENA_ALIGN(n) (((n) + 15) & ~(u64)15)
+
+#ifndef ARENA_MIN_SIZE
+#define ARENA_MIN_SIZE 4096
+#endif
+
+void* arena_alloc(Arena* arena, u64 size) {
+	size = ARENA_ALIGN(size ? size : 1);
+	arena->wanted += size;
+	if (arena->size - arena->used >= size) {
+		void* p = arena->buf + arena->used;
+		arena->used += size;
+		return p;
+	}
+	ArenaChunk* chunk = mg_calloc(1, sizeof(ArenaChunk) + size);
+	if (!chunk)
+		return NULL;
+	chunk->next = arena->overflow;
+	arena->overflow = chunk;
+	return chunk->data;
+}
+
+static void arena_free_overflow(Arena* arena) {
+	while (arena->overflow) {
+		ArenaChunk* next = arena->overflow->next;
+		mg_free(arena->overflow);
+		arena->overflow = next;
+	}
+}
+
+void arena_reset(Arena* arena) {
+	if (arena->overflow) {
+		arena_free_overflow(arena);
+		u64 size = arena->size ? arena->size : ARENA_MIN_SIZE;
+		while (size < arena->wanted)
+			size *= 2;
+		u8* buf = mg_calloc(1, size);
+		if (buf) {
+			mg_free(arena->buf);
+			arena->buf = buf;
+			arena->size = size;
+		}
+	}
+	arena->used = 0;
+	arena->wanted = 0;
+}
+
+void arena_free(Arena* arena) {
+	arena_free_overflow(arena);
+	mg_free(arena->buf);
+	arena->buf = NULL;
+	arena->size = arena->used = arena->wanted = 0;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+// === Includes ===
+#include "types.h"
+#include <stdbool.h>
+
+// === Pools ===
+// mongoose is built with MG_ENABLE_CUSTOM_CALLOC, so its mg_calloc/mg_free
+// (connections, iobufs, timers, mg_json_get_str results) and obs.c share the
+// pools in alloc.c. Requests up to ALLOC_POOL_MAX_SIZE come from per-size
+// free lists refilled a slab at a time, so once a session has warmed up,
+// freeing and reallocating a connection or a buffer never reaches the heap.
+// Pool memory is kept until exit. Larger requests go to calloc/free. Anything
+// from mg_calloc must go back through mg_free. Like mongoose itself, the
+// pools are only used from the main thread and take no locks.
+#ifndef ALLOC_POOL_MAX_SIZE
+#define ALLOC_POOL_MAX_SIZE (64 * 1024)
+#endif
+
+#ifndef ALLOC_SLAB_SIZE
+#define ALLOC_SLAB_SIZE (64 * 1024)
+#endif
+
+// Heap allocations made so far, slabs and large requests alike.
+u64 alloc_heap_count(void);
+
+// === Arenas ===
+// Bump allocator for memory that lives until the next arena_reset, e.g. the
+// strings pulled out of one OBS message. Allocations past the buffer go into
+// overflow chunks; the next reset folds them into one buffer big enough for
+// the peak, so a steady stream of similar messages stops allocating.
+typedef struct ArenaChunk ArenaChunk;
+
+typedef struct Arena {
+	u8* buf;
+	u64 size;
+	u64 used;
+	u64 wanted;		// bytes asked for since the last reset, overflow included
+	ArenaChunk* overflow;
+} Arena;
+
+// Returns size bytes, 16-byte aligned and not zeroed, or NULL when out of memory.
+void* arena_alloc(Arena* arena, u64 size);
+
+void arena_reset(Arena* arena);
+
+void arena_free(Arena* arena);
@@ -0,0 +1,135 @@
+#include "config.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "log.h"
+#include "path.h"
+#include "platform.h"
+
+typedef struct ConfigEntry {
+	char key[64];
+	char value[1024];
+} ConfigEntry;
+
+static ConfigEntry config_entries[CONFIG_MAX_ENTRIES];
+static i32 config_entry_count = 0;
+
+// === Parsing helpers ===
+// Trim leading and trailing whitespace in place and return the new start.
+static char* config_trim(char* s) {
+	while (isspace((u8)*s))
+		s++;
+	char* end = s + strlen(s);
+	while (end > s && isspace((u8)end[-1]))
+		end--;
+	*end = '\0';
+	return s;
+}
+
+// Resolve the config path: environment override first, then next to the executable.
+static i32 config_default_path(char* output, i32 output_size) {
+	const char* env = getenv("SMART_GRECORDING_CONFIG");
+	if (env && *env) {
+		strcpy_s(output, output_size, env);
+		return 0;
+	}
+
+	char exe_path[1024];
+	if (platform_executable_path(exe_path, sizeof(exe_path)))
+		return 1;
+	if (extract_parent_folder(exe_path, output, output_size))
+		return 1;
+	strcat_s(output, output_size, "/" CONFIG_FILE_NAME);
+	return 0;
+}
+
+// === Config file ===
+i32 config_load(void) {
+	char path[1024];
+	if (config_default_path(path, sizeof(path))) {
+		log_warn("could not resolve config file path");
+		return 0;
+	}
+
+	FILE* fp = fopen(path, "r");
+	if (!fp) {
+		log_debug("no config file at %s", path);
+		return 0;
+	}
+
+	i32 err = 0;
+	i32 line_no = 0;
+	char line[1200];
+	config_entry_count = 0;
+	while (fgets(line, sizeof(line), fp)) {
+		line_no++;
+		char* s = config_trim(line);
+		if (*s == '\0' || *s == '#')
+			continue;
+
+		char* eq = strchr(s, '=');
+		if (!eq) {
+			log_error("%s:%d: expected 'key = value'", path, line_no);
+			err = 1;
+			continue;
+		}
+		*eq = '\0';
+		char* key = config_trim(s);
+		char* value = config_trim(eq + 1);
+		if (strlen(key) >= sizeof(config_entries[0].key) || strlen(value) >= sizeof(config_entries[0].value)) {
+			log_error("%s:%d: key or value too long", path, line_no);
+			err = 1;
+			continue;
+		}
+		if (config_entry_count >= CONFIG_MAX_ENTRIES) {
+			log_error("%s:%d: too many entries (max %d)", path, line_no, CONFIG_MAX_ENTRIES);
+			err = 1;
+			break;
+		}
+
+		ConfigEntry* entry = &config_entries[config_entry_count++];
+		strcpy_s(entry->key, sizeof(entry->key), key);
+		strcpy_s(entry->value, sizeof(entry->value), value);
+	}
+
+	fclose(fp);
+	log_info("loaded %d config entries from %s", config_entry_count, path);
+	return err;
+}
+
+// === Lookups ===
+// Later entries win, so a key repeated at the end of the file overrides earlier ones.
+const char* config_get_str(const char* key, const char* fallback) {
+	for (i32 i = config_entry_count - 1; i >= 0; --i) {
+		if (strcmp(config_entries[i].key, key) == 0)
+			return config_entries[i].value;
+	}
+	return fallback;
+}
+
+i64 config_get_int(const char* key, i64 fallback) {
+	const char* value = config_get_str(key, NULL);
+	if (!value || *value == '\0')
+		return fallback;
+
+	char* end = NULL;
+	i64 result = strtoll(value, &end, 0);
+	if (*end != '\0') {
+		log_warn("config '%s' is not an integer: %s", key, value);
+		return fallback;
+	}
+	return result;
+}
+
+bool config_get_bool(const char* key, bool fallback) {
+	const char* value = config_get_str(key, NULL);
+	if (!value)
+		return fallback;
+	if (strcmp(value, "1") == 0 || strcmp(value, "true") == 0 || strcmp(value, "yes") == 0 || strcmp(value, "on") == 0)
+		return true;
+	if (strcmp(value, "0") == 0 || strcmp(value, "false") == 0 || strcmp(value, "no") == 0 || strcmp(value, "off") == 0)
+		return false;
+	log_warn("config '%s' is not a boolean: %s", key, value);
+	return fallback;
+}
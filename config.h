@@ -0,0 +1,25 @@
+#pragma once
+#include "types.h"
+#include <stdbool.h>
+
+// === Config file ===
+// Settings are plain "key = value" lines; '#' starts a comment line.
+// The file is looked up next to the executable unless the
+// SMART_GRECORDING_CONFIG environment variable points elsewhere.
+#ifndef CONFIG_FILE_NAME
+#define CONFIG_FILE_NAME "smart_grecording.cfg"
+#endif
+
+#ifndef CONFIG_MAX_ENTRIES
+#define CONFIG_MAX_ENTRIES 128
+#endif
+
+// Returns 0 when the file was loaded or does not exist, non-zero on parse errors.
+i32 config_load(void);
+
+// === Lookups ===
+const char* config_get_str(const char* key, const char* fallback);
+
+i64 config_get_int(const char* key, i64 fallback);
+
+bool config_get_bool(const char* key, bool fallback);
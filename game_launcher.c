@@ -1,25 +1,105 @@
 #include "game_launcher.h"
-#include <windows.h>
-#include <TlHelp32.h>
+#include "config.h"
 #include "log.h"
 #include "path.h"
+#include "platform.h"
 
-bool try_open_child_process(DWORD parent_pid, PROCESS_INFORMATION* child_info);
+// Milliseconds from now until deadline, clamped at zero.
+static i32 ms_until(u64 deadline_us, u64 now_us) {
+	return deadline_us > now_us ? (i32)((deadline_us - now_us + 999) / 1000) : 0;
+}
 
-// Rebuilds the original CLI into a single command line and executes it.
-i32 launch_target_game(i32 argc, char* argv[]) {
+// Wait for the tracked processes while running periodic work: scans for the
+// configured game_match pattern until a process matches (or the launcher tree
+// is gone and the timeout has passed) and the optional on_tick hook.
+// With hooks->mgr set, the wait is that manager's poll, so OBS traffic is
+// handled as it arrives and the loop only wakes for sockets, exits and the
+// scan/tick deadlines.
+static i32 wait_for_game_session(const char* game_pattern, const PlacementPolicy* placement, const GameSessionHooks* hooks) {
+	u64 scan_interval_us = (u64)config_get_int("game_scan_interval_ms", GAME_SCAN_INTERVAL_MS) * 1000;
+	u64 match_timeout_us = (u64)config_get_int("game_match_timeout_ms", GAME_MATCH_TIMEOUT_MS) * 1000;
+	bool ticking = hooks && hooks->on_tick && hooks->tick_interval_ms > 0;
+	u64 tick_interval_us = ticking ? (u64)hooks->tick_interval_ms * 1000 : 0;
+	struct mg_mgr* mgr = hooks ? hooks->mgr : NULL;
+	u64 start = platform_monotonic_us();
+	u64 next_scan = start + scan_interval_us;
+	u64 next_tick = start + tick_interval_us;
+	bool scanning = game_pattern != NULL;
+	bool drained = false;
+	u64 wakeups = 0;
 	i32 err = 0;
 
-	char command_line[2048] = "";
-	for (i32 i = 1; i < argc; ++i) {
-		strcat_s(command_line, 1024, "\"");
-		strcat_s(command_line, 1024, argv[i]);
-		strcat_s(command_line, 1024, "\"");
-		if (i < argc - 1) {
-			strcat_s(command_line, 1024, " ");
+	if (mgr && platform_process_tree_attach(mgr))
+		mgr = NULL;
+
+	for (;;) {
+		u64 now = platform_monotonic_us();
+		if (ticking && now >= next_tick) {
+			hooks->on_tick(hooks->udata);
+			next_tick += tick_interval_us;
+			if (next_tick <= now)
+				next_tick = now + tick_interval_us;
+		}
+
+		if (scanning && now >= next_scan) {
+			next_scan = now + scan_interval_us;
+			PlatformProcess game;
+			if (platform_scan_for_process(game_pattern, &game)) {
+				log_info("tracking game process %lld", game.pid);
+				i64 game_pid = game.pid;
+				const PlatformPlacement* game_placement = placement_for_game(placement);
+				if (game_placement)
+					platform_apply_placement(game_pid, game_placement);
+				platform_track_process(&game);
+				if (hooks && hooks->on_game_detected)
+					hooks->on_game_detected(game_pid, hooks->udata);
+				scanning = false;
+			} else if (drained && now - start >= match_timeout_us) {
+				log_warn("no process matching '%s' appeared within %llu ms", game_pattern, match_timeout_us / 1000);
+				break;
+			}
 		}
+
+		// Hooks may poll the manager themselves, so exits are collected here
+		// rather than trusted to the wakeup that announced them.
+		err = platform_poll_process_tree(0, &drained);
+		if (err || (drained && !scanning))
+			break;
+
+		now = platform_monotonic_us();
+		i32 timeout_ms = -1;
+		if (scanning)
+			timeout_ms = ms_until(next_scan, now);
+		if (ticking && (timeout_ms < 0 || ms_until(next_tick, now) < timeout_ms))
+			timeout_ms = ms_until(next_tick, now);
+
+		if (mgr) {
+			i32 fallback_ms = platform_process_tree_poll_interval_ms();
+			if (fallback_ms >= 0 && (timeout_ms < 0 || fallback_ms < timeout_ms))
+				timeout_ms = fallback_ms;
+			mg_mgr_poll(mgr, timeout_ms);
+		} else {
+			bool unused;
+			err = platform_poll_process_tree(timeout_ms, &unused);
+			if (err)
+				break;
+		}
+		wakeups++;
 	}
 
+	if (mgr)
+		platform_process_tree_detach();
+	u64 elapsed_ms = (platform_monotonic_us() - start) / 1000;
+	log_info("session loop woke %llu times in %llu ms", wakeups, elapsed_ms);
+	if (hooks && hooks->wakeups)
+		*hooks->wakeups = wakeups;
+	return err;
+}
+
+// Starts argv[1..] as the game and blocks until it (and any handed-over child) exits.
+i32 launch_target_game(i32 argc, char* argv[], const PlacementPolicy* placement, const GameSessionHooks* hooks) {
+	i32 err = 0;
+
 	char game_work_dir[2048];
 	err = extract_parent_folder(argv[1], game_work_dir, sizeof(game_work_dir));
 	if (err) {
@@ -28,54 +108,31 @@ i32 launch_target_game(i32 argc, char* argv[]) {
 	}
 	log_info("parsed game working directory: %s", game_work_dir);
 
-	STARTUPINFOA si;
-	PROCESS_INFORMATION pi;
-	ZeroMemory(&si, sizeof(si));
-	ZeroMemory(&pi, sizeof(pi));
-	si.cb = sizeof(si);
-	BOOL rc = CreateProcessA(NULL, command_line, NULL, NULL, FALSE, 0, NULL, game_work_dir, &si, &pi);
-	err = rc == 0;
-	if (!err) {
-		CloseHandle(pi.hThread);
-		// Wait for the launcher, then follow any child process it spawns (launchers that exit quickly).
-		do {
-			WaitForSingleObject(pi.hProcess, INFINITE);
-			CloseHandle(pi.hProcess);
-		} while (try_open_child_process(pi.dwProcessId, &pi));
-	}
-
-	return err;
-}
-
-bool try_open_child_process(DWORD parent_pid, PROCESS_INFORMATION* child_info) {
-	// Snapshot current processes to find a direct child of the launcher.
-	HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
-	if (snapshot == INVALID_HANDLE_VALUE) {
-		return false;
+	// Processes already running before launch never count as the game.
+	const char* game_pattern = config_get_str("game_match", NULL);
+	if (game_pattern && *game_pattern == '\0')
+		game_pattern = NULL;
+	if (game_pattern) {
+		PlatformProcess unused;
+		platform_scan_reset();
+		platform_scan_for_process(game_pattern, &unused);
 	}
 
-	PROCESSENTRY32 entry;
-	entry.dwSize = sizeof(PROCESSENTRY32);
-
-	if (!Process32First(snapshot, &entry)) {
-		CloseHandle(snapshot);
-		return false;
+	PlatformProcess process;
+	u64 spawn_start = platform_monotonic_us();
+	err = platform_spawn_process(argc - 1, argv + 1, game_work_dir, placement_for_game(placement), &process);
+	if (err) {
+		return err;
 	}
+	log_info("spawned game process %lld in %llu us", process.pid, platform_monotonic_us() - spawn_start);
+	placement_apply_wrapper(placement);
+	i64 root_pid = process.pid;
+	platform_track_process(&process);
+	if (!game_pattern && hooks && hooks->on_game_detected)
+		hooks->on_game_detected(root_pid, hooks->udata);
 
-	HANDLE child = NULL;
-	do {
-		if (entry.th32ParentProcessID == parent_pid) {
-			log_info("found child process %ld: %ls", entry.th32ProcessID, entry.szExeFile);
-			child = OpenProcess(SYNCHRONIZE | PROCESS_QUERY_INFORMATION, FALSE, entry.th32ProcessID);
-			if (child) {
-				child_info->hProcess = child;
-				child_info->dwProcessId = entry.th32ProcessID;
-				break;
-			}
-		}
-	} while (Process32Next(snapshot, &entry));
-
-
-	CloseHandle(snapshot);
-	return child != NULL;
+	err = wait_for_game_session(game_pattern, placement, hooks);
+	if (!err)
+		log_info("game session ended");
+	return err;
 }
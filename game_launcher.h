@@ -1,5 +1,33 @@
 #pragma once
+#include "mongoose.h"
+#include "placement.h"
 #include "types.h"
 
+// How often to look for a process matching the game_match setting.
+#ifndef GAME_SCAN_INTERVAL_MS
+#define GAME_SCAN_INTERVAL_MS 250
+#endif
 
-i32 launch_target_game(i32 argc, char* argv[]);
\ No newline at end of file
+// Give up on game_match this long after launch once the launcher tree is gone.
+#ifndef GAME_MATCH_TIMEOUT_MS
+#define GAME_MATCH_TIMEOUT_MS 120000
+#endif
+
+typedef struct GameSessionHooks {
+	// Called once when the game process is identified: the first process
+	// matching game_match, or the spawned process when no pattern is set.
+	void (*on_game_detected)(i64 pid, void* udata);
+	// Called every tick_interval_ms while the session runs (0 disables it).
+	void (*on_tick)(void* udata);
+	u32 tick_interval_ms;
+	void* udata;
+	// Event loop to wait in, shared with the OBS connection. NULL waits on
+	// the process tree alone and leaves OBS traffic unread until the end.
+	struct mg_mgr* mgr;
+	// When set, receives how many times the session loop woke.
+	u64* wakeups;
+} GameSessionHooks;
+
+// The game placement is applied at spawn (and again to a game_match process
+// when it is detected); the wrapper is pinned once the game is running.
+i32 launch_target_game(i32 argc, char* argv[], const PlacementPolicy* placement, const GameSessionHooks* hooks);
@@ -0,0 +1,59 @@
+#include "idle_detector.h"
+
+void idle_detector_init(IdleDetector* detector, const IdleDetectorConfig* config) {
+	detector->config = *config;
+	detector->idle = false;
+	detector->has_sample = false;
+	detector->last_wall_us = 0;
+	detector->last_cpu_us = 0;
+	detector->condition_since_us = 0;
+}
+
+IdleEvent idle_detector_sample(IdleDetector* detector, u64 now_us, u64 cpu_us, bool stopped) {
+	if (!detector->has_sample || now_us <= detector->last_wall_us) {
+		detector->has_sample = true;
+		detector->last_wall_us = now_us;
+		detector->last_cpu_us = cpu_us;
+		return IDLE_EVENT_NONE;
+	}
+
+	// CPU time drops when a tracked process exits; treat that interval as unknown.
+	u64 wall_delta = now_us - detector->last_wall_us;
+	u64 cpu_delta = cpu_us >= detector->last_cpu_us ? cpu_us - detector->last_cpu_us : 0;
+	u64 cpu_percent = cpu_delta * 100 / wall_delta;
+	detector->last_wall_us = now_us;
+	detector->last_cpu_us = cpu_us;
+
+	if (!detector->idle) {
+		if (stopped) {
+			detector->idle = true;
+			detector->condition_since_us = 0;
+			return IDLE_EVENT_IDLE;
+		}
+		if (cpu_percent >= detector->config.idle_cpu_percent) {
+			detector->condition_since_us = 0;
+			return IDLE_EVENT_NONE;
+		}
+		if (detector->condition_since_us == 0)
+			detector->condition_since_us = now_us - wall_delta;
+		if (now_us - detector->condition_since_us >= (u64)detector->config.idle_after_ms * 1000) {
+			detector->idle = true;
+			detector->condition_since_us = 0;
+			return IDLE_EVENT_IDLE;
+		}
+		return IDLE_EVENT_NONE;
+	}
+
+	if (stopped || cpu_percent < detector->config.active_cpu_percent) {
+		detector->condition_since_us = 0;
+		return IDLE_EVENT_NONE;
+	}
+	if (detector->condition_since_us == 0)
+		detector->condition_since_us = now_us - wall_delta;
+	if (now_us - detector->condition_since_us >= (u64)detector->config.active_after_ms * 1000) {
+		detector->idle = false;
+		detector->condition_since_us = 0;
+		return IDLE_EVENT_ACTIVE;
+	}
+	return IDLE_EVENT_NONE;
+}
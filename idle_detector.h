@@ -0,0 +1,35 @@
+#pragma once
+#include "types.h"
+#include <stdbool.h>
+
+// === Idle detection ===
+// Turns periodic CPU-time samples of the game into idle/active transitions.
+// Hysteresis comes from two thresholds and two hold times: the game must stay
+// below idle_cpu_percent for idle_after_ms to go idle, and above
+// active_cpu_percent for active_after_ms to come back. A suspended game
+// counts as idle immediately.
+typedef struct IdleDetectorConfig {
+	u32 idle_cpu_percent;
+	u32 active_cpu_percent;
+	u32 idle_after_ms;
+	u32 active_after_ms;
+} IdleDetectorConfig;
+
+typedef enum IdleEvent {
+	IDLE_EVENT_NONE,
+	IDLE_EVENT_IDLE,
+	IDLE_EVENT_ACTIVE,
+} IdleEvent;
+
+typedef struct IdleDetector {
+	IdleDetectorConfig config;
+	bool idle;
+	bool has_sample;
+	u64 last_wall_us;
+	u64 last_cpu_us;
+	u64 condition_since_us;		// start of the current below/above-threshold run, 0 if none
+} IdleDetector;
+
+void idle_detector_init(IdleDetector* detector, const IdleDetectorConfig* config);
+
+IdleEvent idle_detector_sample(IdleDetector* detector, u64 now_us, u64 cpu_us, bool stopped);
@@ -21,8 +21,38 @@
  */
 
 #include "log.h"
+#include "log_binary.h"
+#include <ctype.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <signal.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #define MAX_CALLBACKS 32
+#define MAX_MODULES 32
+#define MAX_FIELDS 16
+
+#ifdef _MSC_VER
+#define LOG_THREAD_LOCAL __declspec(thread)
+#else
+#define LOG_THREAD_LOCAL _Thread_local
+#endif
 
 typedef struct {
   log_LogFn fn;
@@ -30,14 +60,167 @@ typedef struct {
   int level;
 } Callback;
 
+typedef struct {
+  char name[32];
+  int level;
+} Module;
+
+typedef struct {
+  uint64_t interval_us;     /* one token per interval, 0 for no limit */
+  uint64_t tolerance_us;    /* interval_us * (burst - 1) */
+  bool collapse;
+} LevelLimit;
+
+typedef struct {
+  char id[LOG_REQUEST_ID_SIZE];   /* empty outside a request */
+  long long latency_us;
+} RequestContext;
+
+/* One queued message. The body is formatted by the caller, since a va_list
+ * cannot outlive the call; the writer thread does everything else. */
+typedef struct {
+  volatile uint64_t seq;
+  uint64_t time_us;
+  RequestContext request;
+  const char *file;
+  int line;
+  int level;
+  bool forced;
+  char msg[LOG_ASYNC_MSG_SIZE];
+} AsyncSlot;
+
+typedef struct {
+  AsyncSlot *slots;
+  uint64_t mask;
+  int reserve_level;
+  volatile uint64_t head;       /* next slot producers claim */
+  volatile uint64_t tail;       /* next slot the writer reads */
+  volatile uint64_t dropped;    /* since the writer last reported */
+  volatile uint64_t dropped_total;
+  volatile uint64_t idle;       /* 1 while the writer waits for work */
+  volatile uint64_t stopping;
+  bool running;
+  bool batching;
+#ifdef _WIN32
+  HANDLE thread;
+  HANDLE wake;
+#else
+  pthread_t thread;
+  sem_t wake;
+#endif
+} AsyncLog;
+
+/* One thread's binary records. Only the owner appends and resets; anyone
+ * holding the binary lock may write out [flushed, len). */
+typedef struct BinaryBuffer {
+  struct BinaryBuffer *next;
+  volatile uint64_t len;
+  uint64_t flushed;
+  unsigned char data[LOG_BINARY_BUFFER_SIZE];
+} BinaryBuffer;
+
+typedef struct {
+  FILE *fp;
+  int level;
+  volatile uint64_t lock;   /* guards fp, the buffer list and site ids */
+  unsigned next_site;
+  BinaryBuffer *buffers;
+} BinaryLog;
+
+typedef struct {
+#ifdef _WIN32
+  HANDLE file;
+  HANDLE mapping;
+#else
+  int fd;
+#endif
+  char *data;
+  size_t size;              /* preallocated and mapped */
+  size_t used;              /* everything past it is zero */
+} MappedFile;
+
+typedef struct {
+  char path[1024];
+  size_t max_size;
+  int keep;
+  volatile uint64_t lock;   /* guards current and the finalizer */
+  bool open;
+  MappedFile current;
+  bool finalizing;          /* a finalizer thread has to be joined */
+#ifdef _WIN32
+  HANDLE finalizer;
+#else
+  pthread_t finalizer;
+#endif
+} MappedLog;
+
+/* One flight record: the event's arguments, encoded as in the binary log. */
+typedef struct {
+  volatile uint64_t seq;    /* position + 1 once written, 0 while writing */
+  const log_Site *site;
+  const char *fmt;
+  uint64_t time_us;
+  uint64_t len;
+  unsigned char args[LOG_FLIGHT_RECORD_SIZE - 40];
+} FlightSlot;
+
+typedef struct {
+  FlightSlot *slots;
+  uint64_t mask;
+  int level;
+  volatile uint64_t head;
+  volatile uint64_t dumping;    /* 1 while a dump is being written */
+  char path[1024];
+} FlightLog;
+
+typedef struct {
+  char key[32];
+  char value[256];          /* already JSON: a string literal, number or null */
+} Field;
+
+typedef struct {
+  FILE *fp;
+  volatile uint64_t lock;   /* guards fields, context and line */
+  Field fields[MAX_FIELDS];
+  char context[MAX_FIELDS * 300];   /* ,"key":value for every field */
+  size_t context_len;
+  char line[LOG_JSON_LINE_SIZE];
+} JsonLog;
+
 static struct {
   void *udata;
   log_LockFn lock;
   int level;
   bool quiet;
   Callback callbacks[MAX_CALLBACKS];
+  int callback_level;       /* lowest callback level, if any callbacks */
+  Module modules[MAX_MODULES];
+  LevelLimit limits[LOG_FATAL + 1];
+  volatile uint64_t held_lock;  /* guards the held list */
+  log_Site *held;
+  bool held_registered;
+  AsyncLog async;
+  BinaryLog binary;
+  MappedLog mapped;
+  JsonLog json;
+  FlightLog flight;
 } L;
 
+/* Local time of the last second this thread logged in, formatted once. */
+typedef struct {
+  time_t second;
+  struct tm tm;
+  char stamp[32];
+} TimeCache;
+
+static LOG_THREAD_LOCAL BinaryBuffer *thread_binary;
+static LOG_THREAD_LOCAL TimeCache thread_time;
+static LOG_THREAD_LOCAL char thread_msg[LOG_MSG_SIZE];
+static LOG_THREAD_LOCAL RequestContext thread_request;
+
+/* Bumped whenever a level changes, so call sites re-check themselves. */
+volatile unsigned log_generation = 1;
+
 
 static const char *level_strings[] = {
   "TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL"
@@ -51,33 +234,28 @@ static const char *level_colors[] = {
 
 
 static void stdout_callback(log_Event *ev) {
-  char buf[16];
-  buf[strftime(buf, sizeof(buf), "%H:%M:%S", ev->time)] = '\0';
+  const char *clock = ev->timestamp + 11;   /* "HH:MM:SS" */
 #ifdef LOG_USE_COLOR
   fprintf(
-    ev->udata, "%s %s%-5s\x1b[0m \x1b[90m%s:%d:\x1b[0m ",
-    buf, level_colors[ev->level], level_strings[ev->level],
-    ev->file, ev->line);
+    ev->udata, "%s %s%-5s\x1b[0m \x1b[90m%s:%d:\x1b[0m %.*s\n",
+    clock, level_colors[ev->level], level_strings[ev->level],
+    ev->file, ev->line, (int) ev->msg_len, ev->msg);
 #else
   fprintf(
-    ev->udata, "%s %-5s %s:%d: ",
-    buf, level_strings[ev->level], ev->file, ev->line);
+    ev->udata, "%s %-5s %s:%d: %.*s\n",
+    clock, level_strings[ev->level], ev->file, ev->line,
+    (int) ev->msg_len, ev->msg);
 #endif
-  vfprintf(ev->udata, ev->fmt, ev->ap);
-  fprintf(ev->udata, "\n");
-  fflush(ev->udata);
+  if (!L.async.batching) { fflush(ev->udata); }
 }
 
 
 static void file_callback(log_Event *ev) {
-  char buf[64];
-  buf[strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", ev->time)] = '\0';
   fprintf(
-    ev->udata, "%s %-5s %s:%d: ",
-    buf, level_strings[ev->level], ev->file, ev->line);
-  vfprintf(ev->udata, ev->fmt, ev->ap);
-  fprintf(ev->udata, "\n");
-  fflush(ev->udata);
+    ev->udata, "%s %-5s %s:%d: %.*s\n",
+    ev->timestamp, level_strings[ev->level], ev->file, ev->line,
+    (int) ev->msg_len, ev->msg);
+  if (!L.async.batching) { fflush(ev->udata); }
 }
 
 
@@ -96,6 +274,17 @@ const char* log_level_string(int level) {
 }
 
 
+/* Case-insensitive level name to level, or -1 if the name is unknown. */
+int log_level_from_string(const char *name) {
+  for (int level = LOG_TRACE; level <= LOG_FATAL; level++) {
+    const char *a = name, *b = level_strings[level];
+    while (*a && toupper((unsigned char) *a) == *b) { a++; b++; }
+    if (*a == '\0' && *b == '\0') { return level; }
+  }
+  return -1;
+}
+
+
 void log_set_lock(log_LockFn fn, void *udata) {
   L.lock = fn;
   L.udata = udata;
@@ -104,18 +293,43 @@ void log_set_lock(log_LockFn fn, void *udata) {
 
 void log_set_level(int level) {
   L.level = level;
+  log_generation++;
 }
 
 
 void log_set_quiet(bool enable) {
   L.quiet = enable;
+  log_generation++;
+}
+
+
+int log_set_module_level(const char *module, int level) {
+  Module *free_slot = NULL;
+  for (int i = 0; i < MAX_MODULES; i++) {
+    Module *m = &L.modules[i];
+    if (!m->name[0]) {
+      if (!free_slot) { free_slot = m; }
+    } else if (!strcmp(m->name, module)) {
+      if (level < 0) { m->name[0] = '\0'; } else { m->level = level; }
+      log_generation++;
+      return 0;
+    }
+  }
+  if (level < 0) { return 0; }
+  if (!free_slot || strlen(module) >= sizeof(free_slot->name)) { return -1; }
+  strcpy(free_slot->name, module);
+  free_slot->level = level;
+  log_generation++;
+  return 0;
 }
 
 
 int log_add_callback(log_LogFn fn, void *udata, int level) {
   for (int i = 0; i < MAX_CALLBACKS; i++) {
     if (!L.callbacks[i].fn) {
+      if (i == 0 || level < L.callback_level) { L.callback_level = level; }
       L.callbacks[i] = (Callback) { fn, udata, level };
+      log_generation++;
       return 0;
     }
   }
@@ -128,41 +342,1412 @@ int log_add_fp(FILE *fp, int level) {
 }
 
 
-static void init_event(log_Event *ev, void *udata) {
-  if (!ev->time) {
-    time_t t = time(NULL);
-    ev->time = localtime(&t);
+static void cache_time(time_t t) {
+  TimeCache *c = &thread_time;
+  if (c->stamp[0] && c->second == t) { return; }
+#ifdef _WIN32
+  localtime_s(&c->tm, &t);
+#else
+  localtime_r(&t, &c->tm);
+#endif
+  strftime(c->stamp, sizeof(c->stamp), "%Y-%m-%d %H:%M:%S", &c->tm);
+  c->second = t;
+}
+
+
+/* Hand one formatted record to stderr and every callback. The only variadic
+ * argument is the body, so callbacks that use fmt/ap see "%s" and the body. */
+static void dispatch(log_Event *ev, ...) {
+  va_list ap;
+  va_start(ap, ev);
+  ev->fmt = "%s";
+  if (!L.quiet && (ev->forced || ev->level >= L.level)) {
+    ev->udata = stderr;
+    va_copy(ev->ap, ap);
+    stdout_callback(ev);
+    va_end(ev->ap);
+  }
+
+  for (int i = 0; i < MAX_CALLBACKS && L.callbacks[i].fn; i++) {
+    Callback *cb = &L.callbacks[i];
+    if (ev->forced || ev->level >= cb->level) {
+      ev->udata = cb->udata;
+      va_copy(ev->ap, ap);
+      cb->fn(ev);
+      va_end(ev->ap);
+    }
   }
-  ev->udata = udata;
+  va_end(ap);
 }
 
 
-void log_log(int level, const char *file, int line, const char *fmt, ...) {
+static void dispatch_text(int level, const char *file, int line, bool forced, uint64_t time_us,
+                          const RequestContext *request, const char *msg, size_t len) {
+  cache_time((time_t) (time_us / 1000000));
   log_Event ev = {
-    .fmt   = fmt,
     .file  = file,
     .line  = line,
     .level = level,
+    .forced = forced,
+    .time  = &thread_time.tm,
+    .timestamp = thread_time.stamp,
+    .time_us = time_us,
+    .request_id = request && request->id[0] ? request->id : NULL,
+    .latency_us = request ? request->latency_us : -1,
+    .msg = msg,
+    .msg_len = len,
   };
+  dispatch(&ev, msg);
+}
 
-  lock();
 
-  if (!L.quiet && level >= L.level) {
-    init_event(&ev, stderr);
-    va_start(ev.ap, fmt);
-    stdout_callback(&ev);
-    va_end(ev.ap);
+/* Atomics and threads for the async writer, so log.c stays self-contained. */
+#ifdef _WIN32
+static uint64_t atomic_load64(volatile uint64_t *p) {
+  return (uint64_t) InterlockedOr64((volatile LONG64 *) p, 0);
+}
+static void atomic_store64(volatile uint64_t *p, uint64_t v) {
+  InterlockedExchange64((volatile LONG64 *) p, (LONG64) v);
+}
+static uint64_t atomic_exchange64(volatile uint64_t *p, uint64_t v) {
+  return (uint64_t) InterlockedExchange64((volatile LONG64 *) p, (LONG64) v);
+}
+static bool atomic_cas64(volatile uint64_t *p, uint64_t expected, uint64_t desired) {
+  return (uint64_t) InterlockedCompareExchange64(
+    (volatile LONG64 *) p, (LONG64) desired, (LONG64) expected) == expected;
+}
+static uint64_t atomic_add64(volatile uint64_t *p, uint64_t v) {
+  return (uint64_t) InterlockedExchangeAdd64((volatile LONG64 *) p, (LONG64) v);
+}
+static void wake_writer(void)   { ReleaseSemaphore(L.async.wake, 1, NULL); }
+static void wait_for_work(void) { WaitForSingleObject(L.async.wake, INFINITE); }
+static void sleep_briefly(void) { Sleep(1); }
+static void yield_briefly(void) { SwitchToThread(); }
+static uint64_t now_us(void) {
+  FILETIME ft;
+  GetSystemTimePreciseAsFileTime(&ft);
+  uint64_t t = ((uint64_t) ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+  return (t - 116444736000000000ull) / 10;
+}
+#else
+static uint64_t atomic_load64(volatile uint64_t *p) {
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+static void atomic_store64(volatile uint64_t *p, uint64_t v) {
+  __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+static uint64_t atomic_exchange64(volatile uint64_t *p, uint64_t v) {
+  return __atomic_exchange_n(p, v, __ATOMIC_SEQ_CST);
+}
+static bool atomic_cas64(volatile uint64_t *p, uint64_t expected, uint64_t desired) {
+  return __atomic_compare_exchange_n(
+    p, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+}
+static uint64_t atomic_add64(volatile uint64_t *p, uint64_t v) {
+  return __atomic_fetch_add(p, v, __ATOMIC_RELAXED);
+}
+static void wake_writer(void) { sem_post(&L.async.wake); }
+static void wait_for_work(void) {
+  while (sem_wait(&L.async.wake) < 0 && errno == EINTR) {}
+}
+static void sleep_briefly(void) {
+  struct timespec ts = { 0, 1000000 };
+  nanosleep(&ts, NULL);
+}
+static void yield_briefly(void) { sched_yield(); }
+static uint64_t now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (uint64_t) ts.tv_sec * 1000000 + (uint64_t) ts.tv_nsec / 1000;
+}
+#endif
+
+
+/* Claim a slot (bounded MPMC queue, one sequence number per slot). Messages
+ * below reserve_level are refused once the ring is 3/4 full, so warnings and
+ * errors still fit during a burst; a full ring drops anything. Never blocks. */
+static AsyncSlot *async_claim(int level) {
+  AsyncLog *a = &L.async;
+  uint64_t pos = atomic_load64(&a->head);
+  for (;;) {
+    if (level < a->reserve_level &&
+        pos - atomic_load64(&a->tail) >= (a->mask + 1) - (a->mask + 1) / 4) {
+      return NULL;
+    }
+    AsyncSlot *slot = &a->slots[pos & a->mask];
+    int64_t diff = (int64_t) (atomic_load64(&slot->seq) - pos);
+    if (diff == 0) {
+      if (atomic_cas64(&a->head, pos, pos + 1)) { return slot; }
+      pos = atomic_load64(&a->head);
+    } else if (diff < 0) {
+      return NULL;
+    } else {
+      pos = atomic_load64(&a->head);
+    }
   }
+}
+
+
+static void async_publish(AsyncSlot *slot) {
+  uint64_t pos = slot->seq;
+  atomic_store64(&slot->seq, pos + 1);
+  if (atomic_exchange64(&L.async.idle, 0)) { wake_writer(); }
+}
+
+
+static void async_write(const AsyncSlot *slot) {
+  dispatch_text(slot->level, slot->file, slot->line, slot->forced, slot->time_us,
+                &slot->request, slot->msg, strlen(slot->msg));
+}
+
 
+static void flush_sinks(void) {
+  fflush(stderr);
   for (int i = 0; i < MAX_CALLBACKS && L.callbacks[i].fn; i++) {
-    Callback *cb = &L.callbacks[i];
-    if (level >= cb->level) {
-      init_event(&ev, cb->udata);
-      va_start(ev.ap, fmt);
-      cb->fn(&ev);
-      va_end(ev.ap);
+    if (L.callbacks[i].fn == file_callback) { fflush(L.callbacks[i].udata); }
+  }
+  if (L.json.fp) { fflush(L.json.fp); }
+}
+
+
+/* Drain whatever is queued, then flush each sink once for the whole batch. */
+static bool async_drain(void) {
+  AsyncLog *a = &L.async;
+  uint64_t pos = a->tail;
+  uint64_t reported = 0;
+  bool any = false;
+  lock();
+  a->batching = true;
+  for (;;) {
+    AsyncSlot *slot = &a->slots[pos & a->mask];
+    if (atomic_load64(&slot->seq) != pos + 1) { break; }
+    async_write(slot);
+    atomic_store64(&slot->seq, pos + a->mask + 1);
+    atomic_store64(&a->tail, ++pos);
+    any = true;
+  }
+  uint64_t dropped = atomic_exchange64(&a->dropped, 0);
+  if (dropped) {
+    char msg[64];
+    int len = snprintf(msg, sizeof(msg), "log: dropped %llu messages", (unsigned long long) dropped);
+    dispatch_text(LOG_WARN, __FILE__, __LINE__, false, now_us(), NULL, msg, (size_t) len);
+    reported = dropped;
+  }
+  a->batching = false;
+  if (any || reported) { flush_sinks(); }
+  unlock();
+  return any;
+}
+
+
+#ifdef _WIN32
+static DWORD WINAPI async_main(LPVOID arg) {
+#else
+static void *async_main(void *arg) {
+#endif
+  (void) arg;
+  AsyncLog *a = &L.async;
+  for (;;) {
+    if (async_drain()) { continue; }
+    if (atomic_load64(&a->stopping)) { break; }
+    /* Announce the wait, then look again so a message published in between
+     * is not left waiting for the next one. The announcement is an exchange,
+     * not a store: a store could pass the load below (StoreLoad), letting the
+     * producer see idle == 0 and skip the wake while we miss its message. */
+    atomic_exchange64(&a->idle, 1);
+    if (atomic_load64(&a->slots[a->tail & a->mask].seq) == a->tail + 1 ||
+        atomic_load64(&a->stopping)) {
+      if (atomic_exchange64(&a->idle, 0)) { continue; }
+    }
+    wait_for_work();
+  }
+  async_drain();
+  return 0;
+}
+
+
+int log_async_start(int slots, int reserve_level) {
+  AsyncLog *a = &L.async;
+  if (a->running) { return 0; }
+  uint64_t capacity = 64;
+  while (capacity < (uint64_t) slots) { capacity <<= 1; }
+  a->slots = calloc(capacity, sizeof(AsyncSlot));
+  if (!a->slots) { return -1; }
+  for (uint64_t i = 0; i < capacity; i++) { a->slots[i].seq = i; }
+  a->mask = capacity - 1;
+  a->reserve_level = reserve_level;
+  a->head = a->tail = a->dropped = a->dropped_total = a->idle = a->stopping = 0;
+#ifdef _WIN32
+  a->wake = CreateSemaphoreA(NULL, 0, LONG_MAX, NULL);
+  a->thread = a->wake ? CreateThread(NULL, 0, async_main, NULL, 0, NULL) : NULL;
+  if (!a->thread) {
+    if (a->wake) { CloseHandle(a->wake); }
+#else
+  if (sem_init(&a->wake, 0, 0) != 0) {
+    free(a->slots);
+    return -1;
+  }
+  if (pthread_create(&a->thread, NULL, async_main, NULL) != 0) {
+    sem_destroy(&a->wake);
+#endif
+    free(a->slots);
+    a->slots = NULL;
+    return -1;
+  }
+  a->running = true;
+  atexit(log_async_stop);
+  return 0;
+}
+
+
+void log_async_stop(void) {
+  AsyncLog *a = &L.async;
+  if (!a->running) { return; }
+  atomic_store64(&a->stopping, 1);
+  wake_writer();
+#ifdef _WIN32
+  WaitForSingleObject(a->thread, INFINITE);
+  CloseHandle(a->thread);
+  CloseHandle(a->wake);
+#else
+  pthread_join(a->thread, NULL);
+  sem_destroy(&a->wake);
+#endif
+  a->running = false;
+  free(a->slots);
+  a->slots = NULL;
+}
+
+
+/* Wait until everything queued before the call has reached the sinks. Gives
+ * up after LOG_FLUSH_TIMEOUT_MS so a wedged sink cannot hang the caller. */
+bool log_flush(void) {
+  AsyncLog *a = &L.async;
+  if (!a->running) { return true; }
+  uint64_t target = atomic_load64(&a->head);
+  atomic_store64(&a->idle, 0);
+  wake_writer();
+  for (int waited = 0; waited < LOG_FLUSH_TIMEOUT_MS; waited++) {
+    if (atomic_load64(&a->tail) >= target) { return true; }
+    sleep_briefly();
+  }
+  return false;
+}
+
+
+unsigned long long log_async_dropped(void) {
+  return atomic_load64(&L.async.dropped_total);
+}
+
+
+static void spin_lock(volatile uint64_t *lock) {
+  while (!atomic_cas64(lock, 0, 1)) { yield_briefly(); }
+}
+
+
+static void spin_unlock(volatile uint64_t *lock) {
+  atomic_store64(lock, 0);
+}
+
+
+/* === Binary log === */
+static void binary_lock(void) {
+  spin_lock(&L.binary.lock);
+}
+
+
+static void binary_unlock(void) {
+  spin_unlock(&L.binary.lock);
+}
+
+
+static unsigned char *put16(unsigned char *p, uint64_t v) {
+  p[0] = (unsigned char) v; p[1] = (unsigned char) (v >> 8);
+  return p + 2;
+}
+
+
+static unsigned char *put32(unsigned char *p, uint64_t v) {
+  for (int i = 0; i < 4; i++) { p[i] = (unsigned char) (v >> (8 * i)); }
+  return p + 4;
+}
+
+
+static unsigned char *put64(unsigned char *p, uint64_t v) {
+  for (int i = 0; i < 8; i++) { p[i] = (unsigned char) (v >> (8 * i)); }
+  return p + 8;
+}
+
+
+/* Write the site record once, under the lock, before any event can use it. */
+static void binary_define(log_Site *site, const char *fmt) {
+  binary_lock();
+  if (!site->id) {
+    unsigned char head[16];
+    size_t file_len = strlen(site->file), fmt_len = strlen(fmt);
+    if (file_len > 0xffff) { file_len = 0xffff; }
+    if (fmt_len > 0xffff) { fmt_len = 0xffff; }
+    unsigned char *p = head;
+    *p++ = 'S';
+    p = put32(p, ++L.binary.next_site);
+    *p++ = (unsigned char) site->level;
+    p = put32(p, (uint64_t) site->line);
+    p = put16(p, file_len);
+    fwrite(head, 1, (size_t) (p - head), L.binary.fp);
+    fwrite(site->file, 1, file_len, L.binary.fp);
+    put16(head, fmt_len);
+    fwrite(head, 1, 2, L.binary.fp);
+    fwrite(fmt, 1, fmt_len, L.binary.fp);
+    site->id = L.binary.next_site;
+  }
+  binary_unlock();
+}
+
+
+/* Caller holds the binary lock. */
+static void binary_write_out(BinaryBuffer *b) {
+  uint64_t end = atomic_load64(&b->len);
+  if (end > b->flushed) {
+    fwrite(b->data + b->flushed, 1, (size_t) (end - b->flushed), L.binary.fp);
+    b->flushed = end;
+  }
+}
+
+
+static BinaryBuffer *binary_attach(void) {
+  BinaryBuffer *b = calloc(1, sizeof(BinaryBuffer));
+  if (!b) { return NULL; }
+  binary_lock();
+  b->next = L.binary.buffers;
+  L.binary.buffers = b;
+  binary_unlock();
+  thread_binary = b;
+  return b;
+}
+
+
+static uint64_t binary_int(va_list *ap, const char *length) {
+  if (!strcmp(length, "l"))  { return (uint64_t) va_arg(*ap, long); }
+  if (!strcmp(length, "ll")) { return (uint64_t) va_arg(*ap, long long); }
+  if (!strcmp(length, "z"))  { return (uint64_t) va_arg(*ap, size_t); }
+  if (!strcmp(length, "j"))  { return (uint64_t) va_arg(*ap, intmax_t); }
+  if (!strcmp(length, "t"))  { return (uint64_t) va_arg(*ap, ptrdiff_t); }
+  return (uint64_t) (int64_t) va_arg(*ap, int);
+}
+
+
+static uint64_t binary_uint(va_list *ap, const char *length) {
+  if (!strcmp(length, "l"))  { return (uint64_t) va_arg(*ap, unsigned long); }
+  if (!strcmp(length, "ll")) { return (uint64_t) va_arg(*ap, unsigned long long); }
+  if (!strcmp(length, "z"))  { return (uint64_t) va_arg(*ap, size_t); }
+  if (!strcmp(length, "j"))  { return (uint64_t) va_arg(*ap, uintmax_t); }
+  if (!strcmp(length, "t"))  { return (uint64_t) va_arg(*ap, ptrdiff_t); }
+  return (uint64_t) va_arg(*ap, unsigned int);
+}
+
+
+/* Encode the arguments of fmt into [p, end). Walking the format only decides
+ * how to pull each argument; nothing is formatted. Arguments that do not fit
+ * are left out. Returns the end of what was written. */
+static unsigned char *encode_args(unsigned char *p, unsigned char *end, const char *fmt, va_list ap) {
+  va_list copy;
+  va_copy(copy, ap);
+  log_Conversion c;
+  const char *f = fmt;
+  while (log_next_conversion(&f, &c)) {
+    for (int i = 0; i < c.stars; i++) {
+      int v = va_arg(copy, int);
+      if (end - p >= 8) { p = put64(p, (uint64_t) (int64_t) v); }
+    }
+    uint64_t v = 0;
+    switch (c.kind) {
+      case LOG_ARG_INT:  v = binary_int(&copy, c.length); break;
+      case LOG_ARG_UINT: v = binary_uint(&copy, c.length); break;
+      case LOG_ARG_POINTER: v = (uint64_t) (uintptr_t) va_arg(copy, void *); break;
+      case LOG_ARG_DOUBLE: {
+        double d = c.length[0] == 'L' ? (double) va_arg(copy, long double) : va_arg(copy, double);
+        memcpy(&v, &d, sizeof(v));
+        break;
+      }
+      case LOG_ARG_STRING: {
+        const char *str = va_arg(copy, const char *);
+        if (c.length[0] == 'l') { str = "(wide)"; }
+        if (!str) { str = "(null)"; }
+        size_t len = strlen(str);
+        if (len > LOG_BINARY_MAX_STRING) { len = LOG_BINARY_MAX_STRING; }
+        if (end - p < 2) { continue; }
+        if (len > (size_t) (end - p - 2)) { len = (size_t) (end - p - 2); }
+        p = put16(p, len);
+        memcpy(p, str, len);
+        p += len;
+        continue;
+      }
+      default:
+        if (c.conv == 'n') { (void) va_arg(copy, void *); }
+        continue;
+    }
+    if (end - p >= 8) { p = put64(p, v); }
+  }
+  va_end(copy);
+  return p;
+}
+
+
+/* Append one event to this thread's buffer. */
+static void binary_record(log_Site *site, const char *fmt, va_list ap) {
+  BinaryBuffer *b = thread_binary ? thread_binary : binary_attach();
+  if (!b) { return; }
+  if (!site->id) { binary_define(site, fmt); }
+  if (LOG_BINARY_BUFFER_SIZE - b->len < LOG_BINARY_MAX_RECORD) {
+    binary_lock();
+    binary_write_out(b);
+    b->flushed = 0;
+    atomic_store64(&b->len, 0);
+    binary_unlock();
+  }
+
+  unsigned char *start = b->data + b->len;
+  unsigned char *p = start;
+  *p++ = 'E';
+  p = put32(p, site->id);
+  p = put64(p, now_us());
+  unsigned char *args = p;
+  p = encode_args(p + 2, start + LOG_BINARY_MAX_RECORD, fmt, ap);
+  put16(args, (uint64_t) (p - args - 2));
+  atomic_store64(&b->len, b->len + (uint64_t) (p - start));
+}
+
+
+/* Write out every thread's pending records, e.g. before a crash or exit. */
+void log_binary_flush(void) {
+  if (!L.binary.fp) { return; }
+  binary_lock();
+  for (BinaryBuffer *b = L.binary.buffers; b; b = b->next) { binary_write_out(b); }
+  fflush(L.binary.fp);
+  binary_unlock();
+}
+
+
+static void binary_close(void) {
+  log_binary_flush();
+  binary_lock();
+  if (L.binary.fp) { fclose(L.binary.fp); }
+  L.binary.fp = NULL;
+  binary_unlock();
+}
+
+
+int log_add_binary(const char *path, int level) {
+  if (L.binary.fp) { return -1; }
+  FILE *fp = fopen(path, "wb");
+  if (!fp) { return -1; }
+  unsigned char head[8] = { 0 };
+  memcpy(head, LOG_BINARY_MAGIC, 6);
+  head[6] = LOG_BINARY_VERSION;
+  fwrite(head, 1, sizeof(head), fp);
+  L.binary.level = level;
+  L.binary.fp = fp;
+  log_generation++;
+  atexit(binary_close);
+  return 0;
+}
+
+
+/* === Mapped file log === */
+#ifdef _WIN32
+static int mapped_open(const char *path, size_t size, MappedFile *f) {
+  memset(f, 0, sizeof(*f));
+  /* Sharing delete access lets rotation rename the file while it is open. */
+  f->file = CreateFileA(
+    path, GENERIC_READ | GENERIC_WRITE,
+    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+    OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (f->file == INVALID_HANDLE_VALUE) { return -1; }
+  LARGE_INTEGER existing;
+  if (GetFileSizeEx(f->file, &existing) && (uint64_t) existing.QuadPart > size) {
+    size = (size_t) existing.QuadPart;
+  }
+  /* Mapping past the end grows the file to the full size. */
+  f->mapping = CreateFileMappingA(
+    f->file, NULL, PAGE_READWRITE, (DWORD) ((uint64_t) size >> 32), (DWORD) size, NULL);
+  f->data = f->mapping ? MapViewOfFile(f->mapping, FILE_MAP_WRITE, 0, 0, size) : NULL;
+  if (!f->data) {
+    if (f->mapping) { CloseHandle(f->mapping); }
+    CloseHandle(f->file);
+    return -1;
+  }
+  f->size = size;
+  return 0;
+}
+
+
+static void mapped_sync(MappedFile *f) {
+  FlushViewOfFile(f->data, f->used);
+}
+
+
+/* Unmap, then cut the preallocated tail off so the file ends at its text. */
+static void mapped_finalize(MappedFile *f) {
+  FlushViewOfFile(f->data, f->used);
+  UnmapViewOfFile(f->data);
+  CloseHandle(f->mapping);
+  LARGE_INTEGER end;
+  end.QuadPart = (LONGLONG) f->used;
+  if (SetFilePointerEx(f->file, end, NULL, FILE_BEGIN)) { SetEndOfFile(f->file); }
+  FlushFileBuffers(f->file);
+  CloseHandle(f->file);
+}
+
+
+static void rename_file(const char *from, const char *to) {
+  MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING);
+}
+#else
+static int mapped_open(const char *path, size_t size, MappedFile *f) {
+  memset(f, 0, sizeof(*f));
+  f->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (f->fd < 0) { return -1; }
+  struct stat st;
+  if (fstat(f->fd, &st) == 0 && (uint64_t) st.st_size > size) {
+    size = (size_t) st.st_size;
+  } else {
+    /* Reserve the blocks up front: a store into a sparse hole on a full disk
+     * would raise SIGBUS instead of failing here. */
+#ifdef __linux__
+    if (posix_fallocate(f->fd, 0, (off_t) size) != 0 && ftruncate(f->fd, (off_t) size) != 0) {
+#else
+    if (ftruncate(f->fd, (off_t) size) != 0) {
+#endif
+      close(f->fd);
+      return -1;
+    }
+  }
+  void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, f->fd, 0);
+  if (data == MAP_FAILED) {
+    close(f->fd);
+    return -1;
+  }
+  f->data = data;
+  f->size = size;
+  return 0;
+}
+
+
+static void mapped_sync(MappedFile *f) {
+  msync(f->data, f->used, MS_SYNC);
+}
+
+
+/* Unmap, then cut the preallocated tail off so the file ends at its text. */
+static void mapped_finalize(MappedFile *f) {
+  msync(f->data, f->used, MS_SYNC);
+  munmap(f->data, f->size);
+  if (ftruncate(f->fd, (off_t) f->used) != 0) {}
+  close(f->fd);
+}
+
+
+static void rename_file(const char *from, const char *to) {
+  rename(from, to);
+}
+#endif
+
+
+/* A file left behind by a crash keeps its zeroed tail; its text ends at the
+ * last non-zero byte. A torn final line gets its newline back. */
+static void mapped_find_end(MappedFile *f) {
+  size_t used = f->size;
+  while (used > 0 && f->data[used - 1] == '\0') { used--; }
+  if (used > 0 && used < f->size && f->data[used - 1] != '\n') {
+    f->data[used++] = '\n';
+  }
+  f->used = used;
+}
+
+
+#ifdef _WIN32
+static DWORD WINAPI mapped_finalizer_main(LPVOID arg) {
+#else
+static void *mapped_finalizer_main(void *arg) {
+#endif
+  mapped_finalize(arg);
+  free(arg);
+  return 0;
+}
+
+
+static void mapped_join(void) {
+  MappedLog *m = &L.mapped;
+  if (!m->finalizing) { return; }
+#ifdef _WIN32
+  WaitForSingleObject(m->finalizer, INFINITE);
+  CloseHandle(m->finalizer);
+#else
+  pthread_join(m->finalizer, NULL);
+#endif
+  m->finalizing = false;
+}
+
+
+/* Hand a full file to a background thread; syncing it can take a while. */
+static void mapped_retire(const MappedFile *f) {
+  MappedLog *m = &L.mapped;
+  mapped_join();
+  MappedFile *old = malloc(sizeof(MappedFile));
+  if (old) {
+    *old = *f;
+#ifdef _WIN32
+    m->finalizer = CreateThread(NULL, 0, mapped_finalizer_main, old, 0, NULL);
+    m->finalizing = m->finalizer != NULL;
+#else
+    m->finalizing = pthread_create(&m->finalizer, NULL, mapped_finalizer_main, old) == 0;
+#endif
+    if (m->finalizing) { return; }
+    free(old);
+  }
+  mapped_finalize((MappedFile *) f);
+}
+
+
+/* Caller holds the mapped lock. Shifts path -> path.1 -> ... -> path.keep,
+ * deleting the oldest, and starts a fresh file. */
+static int mapped_rotate(void) {
+  MappedLog *m = &L.mapped;
+  char from[sizeof(m->path) + 16], to[sizeof(m->path) + 16];
+  snprintf(to, sizeof(to), "%s.%d", m->path, m->keep);
+  remove(m->keep > 0 ? to : m->path);
+  for (int i = m->keep - 1; i > 0; i--) {
+    snprintf(from, sizeof(from), "%s.%d", m->path, i);
+    snprintf(to, sizeof(to), "%s.%d", m->path, i + 1);
+    rename_file(from, to);
+  }
+  if (m->keep > 0) {
+    snprintf(to, sizeof(to), "%s.1", m->path);
+    rename_file(m->path, to);
+  }
+
+  MappedFile old = m->current;
+  int rc = mapped_open(m->path, m->max_size, &m->current);
+  /* If the rename failed the same file comes back; pick up where it ends. */
+  if (rc == 0) { mapped_find_end(&m->current); }
+  mapped_retire(&old);
+  m->open = rc == 0;
+  return rc;
+}
+
+
+/* Write a line in place. Returns the bytes it needs; when that is more than
+ * room, whatever was written is zeroed again. */
+static size_t mapped_format(char *p, size_t room, log_Event *ev) {
+  int head = snprintf(
+    p, room, "%s %-5s %s:%d: ",
+    ev->timestamp, level_strings[ev->level], ev->file, ev->line);
+  size_t need = head < 0 ? room + 1 : (size_t) head + ev->msg_len + 1;
+  if (need > room) {
+    memset(p, 0, need < room ? need : room);
+    return need;
+  }
+  memcpy(p + head, ev->msg, ev->msg_len);
+  p[need - 1] = '\n';   /* replaces snprintf's terminator */
+  return need;
+}
+
+
+static void mapped_callback(log_Event *ev) {
+  MappedLog *m = &L.mapped;
+  spin_lock(&m->lock);
+  for (int attempt = 0; attempt < 2 && m->open; attempt++) {
+    MappedFile *f = &m->current;
+    size_t need = mapped_format(f->data + f->used, f->size - f->used, ev);
+    if (need <= f->size - f->used) {
+      f->used += need;
+      if (ev->level == LOG_FATAL) { mapped_sync(f); }
+      break;
+    }
+    /* A line larger than a whole file is dropped. */
+    if (f->used == 0 || mapped_rotate() != 0) { break; }
+  }
+  spin_unlock(&m->lock);
+}
+
+
+static void mapped_close(void) {
+  MappedLog *m = &L.mapped;
+  spin_lock(&m->lock);
+  if (m->open) { mapped_finalize(&m->current); }
+  m->open = false;
+  mapped_join();
+  spin_unlock(&m->lock);
+}
+
+
+int log_add_mapped(const char *path, int level, size_t max_size, int keep, bool rotate_on_open) {
+  MappedLog *m = &L.mapped;
+  if (m->open || strlen(path) >= sizeof(m->path) || max_size < 4096) { return -1; }
+  strcpy(m->path, path);
+  m->max_size = max_size;
+  m->keep = keep < 0 ? 0 : keep;
+  if (mapped_open(path, max_size, &m->current) != 0) { return -1; }
+  m->open = true;
+  mapped_find_end(&m->current);
+  if ((rotate_on_open && m->current.used > 0) || m->current.used >= max_size) {
+    if (mapped_rotate() != 0) { return -1; }
+  }
+  if (log_add_callback(mapped_callback, NULL, level) != 0) {
+    mapped_close();
+    return -1;
+  }
+  atexit(mapped_close);
+  return 0;
+}
+
+
+/* === JSON log === */
+/* Append src as the inside of a JSON string, stopping at room. Returns the
+ * new length. */
+static size_t json_escape(char *dst, size_t n, size_t room, const char *src, size_t len) {
+  static const char hex[] = "0123456789abcdef";
+  for (size_t i = 0; i < len && n < room; i++) {
+    unsigned char c = (unsigned char) src[i];
+    if (c == '"' || c == '\\' || c < 0x20) {
+      char esc = c == '"' ? '"' : c == '\\' ? '\\' : c == '\n' ? 'n' :
+                 c == '\r' ? 'r' : c == '\t' ? 't' : 0;
+      size_t need = esc ? 2 : 6;
+      if (room - n < need) { return n; }
+      dst[n++] = '\\';
+      if (esc) {
+        dst[n++] = esc;
+      } else {
+        memcpy(dst + n, "u00", 3);
+        dst[n + 3] = hex[c >> 4];
+        dst[n + 4] = hex[c & 15];
+        n += 5;
+      }
+    } else {
+      dst[n++] = (char) c;
+    }
+  }
+  return n;
+}
+
+
+/* Caller holds the JSON lock. */
+static void json_render_context(void) {
+  JsonLog *j = &L.json;
+  size_t n = 0;
+  for (int i = 0; i < MAX_FIELDS && j->fields[i].key[0]; i++) {
+    int w = snprintf(j->context + n, sizeof(j->context) - n, ",\"%s\":%s",
+                     j->fields[i].key, j->fields[i].value);
+    if (w < 0 || (size_t) w >= sizeof(j->context) - n) { break; }
+    n += (size_t) w;
+  }
+  j->context_len = n;
+}
+
+
+static int json_set(const char *key, const char *value) {
+  JsonLog *j = &L.json;
+  if (strlen(key) >= sizeof(j->fields[0].key)) { return -1; }
+  int rc = -1;
+  spin_lock(&j->lock);
+  for (int i = 0; i < MAX_FIELDS; i++) {
+    Field *f = &j->fields[i];
+    if (!f->key[0] || !strcmp(f->key, key)) {
+      strcpy(f->key, key);
+      strcpy(f->value, value);
+      json_render_context();
+      rc = 0;
+      break;
+    }
+  }
+  spin_unlock(&j->lock);
+  return rc;
+}
+
+
+int log_set_field(const char *key, const char *value) {
+  char json[sizeof(L.json.fields[0].value)] = "null";
+  if (value) {
+    size_t n = 0;
+    json[n++] = '"';
+    n = json_escape(json, n, sizeof(json) - 2, value, strlen(value));
+    json[n++] = '"';
+    json[n] = '\0';
+  }
+  return json_set(key, json);
+}
+
+
+int log_set_field_int(const char *key, long long value) {
+  char json[32];
+  snprintf(json, sizeof(json), "%lld", value);
+  return json_set(key, json);
+}
+
+
+void log_set_request(const char *request_id, long long latency_us) {
+  RequestContext *r = &thread_request;
+  if (!request_id) {
+    r->id[0] = '\0';
+    r->latency_us = -1;
+    return;
+  }
+  snprintf(r->id, sizeof(r->id), "%s", request_id);
+  r->latency_us = latency_us;
+}
+
+
+static void json_callback(log_Event *ev) {
+  JsonLog *j = &L.json;
+  spin_lock(&j->lock);
+  char *p = j->line;
+  /* Room is kept back for the fields that follow the message. */
+  size_t tail = 96 + LOG_REQUEST_ID_SIZE * 2 + j->context_len;
+  size_t room = sizeof(j->line) - tail;
+  int n = snprintf(
+    p, room, "{\"ts_us\":%llu,\"level\":\"%s\",\"src\":\"",
+    (unsigned long long) ev->time_us, level_strings[ev->level]);
+  size_t len = json_escape(p, (size_t) n, room, ev->file, strlen(ev->file));
+  len += (size_t) snprintf(p + len, sizeof(j->line) - len, ":%d\",\"msg\":\"", ev->line);
+  len = json_escape(p, len, room, ev->msg, ev->msg_len);
+  if (ev->request_id) {
+    len += (size_t) snprintf(p + len, sizeof(j->line) - len, "\",\"request_id\":\"");
+    len = json_escape(p, len, sizeof(j->line) - 64 - j->context_len,
+                      ev->request_id, strlen(ev->request_id));
+    len += (size_t) snprintf(p + len, sizeof(j->line) - len, "\"");
+  } else {
+    len += (size_t) snprintf(p + len, sizeof(j->line) - len, "\",\"request_id\":null");
+  }
+  if (ev->request_id && ev->latency_us >= 0) {
+    len += (size_t) snprintf(p + len, sizeof(j->line) - len, ",\"latency_us\":%lld", ev->latency_us);
+  } else {
+    len += (size_t) snprintf(p + len, sizeof(j->line) - len, ",\"latency_us\":null");
+  }
+  memcpy(p + len, j->context, j->context_len);
+  len += j->context_len;
+  p[len++] = '}';
+  p[len++] = '\n';
+  fwrite(p, 1, len, j->fp);
+  if (!L.async.batching) { fflush(j->fp); }
+  spin_unlock(&j->lock);
+}
+
+
+int log_add_json(FILE *fp, int level) {
+  if (L.json.fp) { return -1; }
+  L.json.fp = fp;
+  if (log_add_callback(json_callback, NULL, level) != 0) {
+    L.json.fp = NULL;
+    return -1;
+  }
+  return 0;
+}
+
+
+/* === Flight recorder === */
+static void flight_record(const log_Site *site, const char *fmt, va_list ap) {
+  FlightLog *fl = &L.flight;
+  uint64_t pos = atomic_add64(&fl->head, 1);
+  FlightSlot *slot = &fl->slots[pos & fl->mask];
+  atomic_store64(&slot->seq, 0);
+  slot->site = site;
+  slot->fmt = fmt;
+  slot->time_us = now_us();
+  unsigned char *end = encode_args(slot->args, slot->args + sizeof(slot->args), fmt, ap);
+  slot->len = (uint64_t) (end - slot->args);
+  atomic_store64(&slot->seq, pos + 1);
+}
+
+
+bool log_flight_active(void) {
+  return L.flight.slots != NULL;
+}
+
+
+void log_flight_site(log_Site *site, const char *fmt, ...) {
+  if (!L.flight.slots) { return; }
+  va_list ap;
+  va_start(ap, fmt);
+  flight_record(site, fmt, ap);
+  va_end(ap);
+}
+
+
+/* The dump runs in signal handlers: raw file calls and a static buffer only. */
+#ifdef _WIN32
+typedef HANDLE FlightFile;
+static bool flight_open(const char *path, FlightFile *f) {
+  *f = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  return *f != INVALID_HANDLE_VALUE;
+}
+static void flight_write(FlightFile f, const void *p, size_t n) {
+  DWORD written;
+  WriteFile(f, p, (DWORD) n, &written, NULL);
+}
+static void flight_close(FlightFile f) {
+  FlushFileBuffers(f);
+  CloseHandle(f);
+}
+#else
+typedef int FlightFile;
+static bool flight_open(const char *path, FlightFile *f) {
+  *f = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  return *f >= 0;
+}
+static void flight_write(FlightFile f, const void *p, size_t n) {
+  const char *c = p;
+  while (n > 0) {
+    ssize_t w = write(f, c, n);
+    if (w < 0 && errno == EINTR) { continue; }
+    if (w <= 0) { return; }
+    c += w;
+    n -= (size_t) w;
+  }
+}
+static void flight_close(FlightFile f) {
+  fsync(f);
+  close(f);
+}
+#endif
+
+
+static unsigned char flight_buf[64 * 1024];
+
+
+/* Queue bytes for the dump file, writing the buffer out when it fills. */
+static size_t flight_put(FlightFile f, size_t n, const void *p, size_t len) {
+  if (n + len > sizeof(flight_buf)) {
+    flight_write(f, flight_buf, n);
+    n = 0;
+  }
+  memcpy(flight_buf + n, p, len);
+  return n + len;
+}
+
+
+/* Write the ring, oldest first, as a binary log. Every event gets its own
+ * site record, since site ids are not assigned unless the binary log is on.
+ * A later trigger (a crash after a FATAL) rewrites the file with the newer
+ * events; one that fires during a dump is ignored. */
+void log_flight_dump(void) {
+  FlightLog *fl = &L.flight;
+  if (!fl->slots || atomic_exchange64(&fl->dumping, 1)) { return; }
+  FlightFile f;
+  if (!flight_open(fl->path, &f)) {
+    atomic_store64(&fl->dumping, 0);
+    return;
+  }
+  unsigned char head[64];
+  memset(head, 0, 8);
+  memcpy(head, LOG_BINARY_MAGIC, 6);
+  head[6] = LOG_BINARY_VERSION;
+  size_t n = flight_put(f, 0, head, 8);
+
+  uint64_t end = atomic_load64(&fl->head);
+  uint64_t count = fl->mask + 1;
+  uint64_t pos = end > count ? end - count : 0;
+  FlightSlot copy;
+  for (unsigned id = 1; pos < end; pos++) {
+    FlightSlot *slot = &fl->slots[pos & fl->mask];
+    if (atomic_load64(&slot->seq) != pos + 1) { continue; }
+    memcpy(&copy, slot, sizeof(copy));
+    /* Skip a slot that a writer reused while it was being copied. */
+    if (atomic_load64(&slot->seq) != pos + 1 || copy.len > sizeof(copy.args)) { continue; }
+
+    size_t file_len = strlen(copy.site->file), fmt_len = strlen(copy.fmt);
+    if (file_len > 0xffff) { file_len = 0xffff; }
+    if (fmt_len > 0xffff) { fmt_len = 0xffff; }
+    unsigned char *p = head;
+    *p++ = 'S';
+    p = put32(p, id);
+    *p++ = (unsigned char) copy.site->level;
+    p = put32(p, (uint64_t) copy.site->line);
+    p = put16(p, file_len);
+    n = flight_put(f, n, head, (size_t) (p - head));
+    n = flight_put(f, n, copy.site->file, file_len);
+    put16(head, fmt_len);
+    n = flight_put(f, n, head, 2);
+    n = flight_put(f, n, copy.fmt, fmt_len);
+
+    p = head;
+    *p++ = 'E';
+    p = put32(p, id);
+    p = put64(p, copy.time_us);
+    p = put16(p, copy.len);
+    n = flight_put(f, n, head, (size_t) (p - head));
+    n = flight_put(f, n, copy.args, (size_t) copy.len);
+    id++;
+  }
+  flight_write(f, flight_buf, n);
+  flight_close(f);
+  atomic_store64(&fl->dumping, 0);
+}
+
+
+#ifdef _WIN32
+static LONG WINAPI flight_on_exception(EXCEPTION_POINTERS *info) {
+  (void) info;
+  log_flight_dump();
+  return EXCEPTION_CONTINUE_SEARCH;
+}
+
+
+static BOOL WINAPI flight_on_console(DWORD type) {
+  (void) type;
+  log_flight_dump();
+  return FALSE;
+}
+
+
+static void flight_on_signal(int sig) {
+  log_flight_dump();
+  signal(sig, SIG_DFL);
+  raise(sig);
+}
+
+
+static void flight_install_handlers(void) {
+  SetUnhandledExceptionFilter(flight_on_exception);
+  SetConsoleCtrlHandler(flight_on_console, TRUE);
+  signal(SIGABRT, flight_on_signal);
+}
+#else
+/* Runs with the default action restored (SA_RESETHAND), so re-raising the
+ * signal, or returning to the faulting instruction, ends the process as it
+ * would have without the recorder. */
+static void flight_on_signal(int sig) {
+  int saved = errno;
+  log_flight_dump();
+  errno = saved;
+  raise(sig);
+}
+
+
+static void flight_install_handlers(void) {
+  /* A stack overflow needs its own stack to run the handler on. */
+  static char alt_stack[64 * 1024];
+  stack_t ss;
+  memset(&ss, 0, sizeof(ss));
+  ss.ss_sp = alt_stack;
+  ss.ss_size = sizeof(alt_stack);
+  sigaltstack(&ss, NULL);
+
+  static const int signals[] = { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT, SIGTERM, SIGINT, SIGHUP };
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = flight_on_signal;
+  sa.sa_flags = SA_RESETHAND | SA_NODEFER | SA_ONSTACK;
+  sigemptyset(&sa.sa_mask);
+  for (size_t i = 0; i < sizeof(signals) / sizeof(signals[0]); i++) {
+    struct sigaction old;
+    /* Leave signals the application handles (or ignores) to it. */
+    if (sigaction(signals[i], NULL, &old) == 0 && old.sa_handler != SIG_DFL) { continue; }
+    sigaction(signals[i], &sa, NULL);
+  }
+}
+#endif
+
+
+int log_flight_start(const char *path, int slots, int level) {
+  FlightLog *fl = &L.flight;
+  if (fl->slots || strlen(path) >= sizeof(fl->path)) { return -1; }
+  uint64_t capacity = 64;
+  while (capacity < (uint64_t) slots) { capacity <<= 1; }
+  FlightSlot *ring = calloc(capacity, sizeof(FlightSlot));
+  if (!ring) { return -1; }
+  strcpy(fl->path, path);
+  fl->mask = capacity - 1;
+  fl->level = level;
+  fl->slots = ring;
+  flight_install_handlers();
+  log_generation++;
+  return 0;
+}
+
+
+/* === Entry points === */
+static bool text_enabled(int level) {
+  return (!L.quiet && level >= L.level) ||
+         (L.callbacks[0].fn && level >= L.callback_level);
+}
+
+
+/* Format a body into this thread's buffer. A longer body is cut short and
+ * ends in "..."; log calls run on every thread, so there is no heap or pool
+ * allocation here. */
+static char *format_body(const char *fmt, va_list ap, size_t *len) {
+  va_list copy;
+  va_copy(copy, ap);
+  int n = vsnprintf(thread_msg, sizeof(thread_msg), fmt, copy);
+  va_end(copy);
+  if (n < 0) {
+    n = 0;
+    thread_msg[0] = '\0';
+  } else if ((size_t) n >= sizeof(thread_msg)) {
+    n = (int) sizeof(thread_msg) - 1;
+    memcpy(thread_msg + n - 3, "...", 3);
+  }
+  *len = (size_t) n;
+  return thread_msg;
+}
+
+
+/* Claim and stamp a ring slot, or count the message as dropped. */
+static AsyncSlot *async_slot(int level, const char *file, int line, bool forced) {
+  AsyncSlot *slot = async_claim(level);
+  if (!slot) {
+    atomic_add64(&L.async.dropped, 1);
+    atomic_add64(&L.async.dropped_total, 1);
+    return NULL;
+  }
+  slot->time_us = now_us();
+  slot->request = thread_request;
+  slot->file = file;
+  slot->line = line;
+  slot->level = level;
+  slot->forced = forced;
+  return slot;
+}
+
+
+/* Publish a filled slot. Returns false for a fatal message that could not be
+ * queued or flushed, which the caller then writes itself. */
+static bool async_done(AsyncSlot *slot, int level) {
+  if (!slot) { return level < LOG_FATAL; }
+  async_publish(slot);
+  return level < LOG_FATAL || log_flush();
+}
+
+
+/* Write an already formatted body. */
+static void emit(int level, const char *file, int line, bool forced, const char *msg, size_t len) {
+  if (L.async.running) {
+    AsyncSlot *slot = async_slot(level, file, line, forced);
+    if (slot) {
+      size_t n = len < sizeof(slot->msg) ? len : sizeof(slot->msg) - 1;
+      memcpy(slot->msg, msg, n);
+      slot->msg[n] = '\0';
     }
+    if (async_done(slot, level)) { return; }
   }
+  lock();
+  dispatch_text(level, file, line, forced, now_us(), &thread_request, msg, len);
+  unlock();
+}
+
 
+static void logv(int level, const char *file, int line, bool forced, const char *fmt, va_list ap) {
+  if (L.async.running) {
+    AsyncSlot *slot = async_slot(level, file, line, forced);
+    if (slot) {
+      va_list copy;
+      va_copy(copy, ap);
+      vsnprintf(slot->msg, sizeof(slot->msg), fmt, copy);
+      va_end(copy);
+    }
+    if (async_done(slot, level)) { return; }
+  }
+  size_t len;
+  char *msg = format_body(fmt, ap, &len);
+  lock();
+  dispatch_text(level, file, line, forced, now_us(), &thread_request, msg, len);
   unlock();
 }
+
+
+void log_logv(int level, const char *file, int line, const char *fmt, va_list ap) {
+  logv(level, file, line, false, fmt, ap);
+}
+
+
+void log_log(int level, const char *file, int line, const char *fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  log_logv(level, file, line, fmt, ap);
+  va_end(ap);
+}
+
+
+/* The module is the file name without directory and extension. */
+static int module_level(const char *file) {
+  const char *name = file;
+  for (const char *p = file; *p; p++) {
+    if (*p == '/' || *p == '\\') { name = p + 1; }
+  }
+  const char *dot = strrchr(name, '.');
+  size_t len = dot ? (size_t) (dot - name) : strlen(name);
+  for (int i = 0; i < MAX_MODULES; i++) {
+    const Module *m = &L.modules[i];
+    if (m->name[0] && strlen(m->name) == len && !strncmp(m->name, name, len)) {
+      return m->level;
+    }
+  }
+  return -1;
+}
+
+
+/* === Rate limits === */
+static void site_notice(log_Site *site, const char *fmt, uint64_t count) {
+  char msg[96];
+  int len = snprintf(msg, sizeof(msg), fmt, (unsigned long long) count);
+  emit(site->level, site->file, site->line, site->module_level >= 0, msg, (size_t) len);
+}
+
+
+/* Report what every held site still owes, e.g. at exit. */
+static void held_flush(void) {
+  spin_lock(&L.held_lock);
+  for (log_Site *site = L.held; site; site = site->next_held) {
+    uint64_t n = atomic_exchange64(&site->repeats, 0);
+    if (n) { site_notice(site, "last message repeated %llu times", n); }
+    n = atomic_exchange64(&site->suppressed, 0);
+    if (n) { site_notice(site, "%llu messages from here were rate limited", n); }
+  }
+  spin_unlock(&L.held_lock);
+}
+
+
+/* Remember a site that holds counts back, so they are reported at exit. */
+static void hold(log_Site *site) {
+  if (site->held) { return; }
+  spin_lock(&L.held_lock);
+  if (!site->held) {
+    site->next_held = L.held;
+    L.held = site;
+    site->held = true;
+  }
+  spin_unlock(&L.held_lock);
+}
+
+
+static void register_held_flush(void) {
+  if (!L.held_registered) {
+    L.held_registered = true;
+    atexit(held_flush);
+  }
+}
+
+
+int log_set_rate_limit(int level, int per_second, int burst) {
+  if (level < LOG_TRACE || level > LOG_FATAL) { return -1; }
+  LevelLimit *limit = &L.limits[level];
+  if (per_second <= 0) {
+    limit->interval_us = limit->tolerance_us = 0;
+    return 0;
+  }
+  limit->interval_us = 1000000 / (uint64_t) per_second;
+  if (limit->interval_us == 0) { limit->interval_us = 1; }
+  limit->tolerance_us = limit->interval_us * (uint64_t) (burst > 1 ? burst - 1 : 0);
+  register_held_flush();
+  return 0;
+}
+
+
+int log_set_collapse(int level, bool enable) {
+  if (level < LOG_TRACE || level > LOG_FATAL) { return -1; }
+  L.limits[level].collapse = enable;
+  if (enable) { register_held_flush(); }
+  return 0;
+}
+
+
+/* Token bucket in its GCRA form: next_allowed_us is when the bucket would be
+ * full again, and a message fits while that is at most the burst ahead. */
+static bool rate_allow(log_Site *site, const LevelLimit *limit, uint64_t now) {
+  for (;;) {
+    uint64_t tat = atomic_load64(&site->next_allowed_us);
+    uint64_t start = tat > now ? tat : now;
+    if (start - now > limit->tolerance_us) { return false; }
+    if (atomic_cas64(&site->next_allowed_us, tat, start + limit->interval_us)) { return true; }
+  }
+}
+
+
+/* Returns true when the body repeats the site's previous message. */
+static bool collapse_repeat(log_Site *site, const char *msg, size_t len, uint64_t now) {
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < len; i++) {
+    hash = (hash ^ (unsigned char) msg[i]) * 1099511628211ull;
+  }
+  if (atomic_exchange64(&site->last_hash, hash) == hash) {
+    atomic_add64(&site->repeats, 1);
+    hold(site);
+    uint64_t reported = atomic_load64(&site->reported_us);
+    if (now - reported >= LOG_REPEAT_REPORT_MS * 1000ull &&
+        atomic_cas64(&site->reported_us, reported, now)) {
+      uint64_t n = atomic_exchange64(&site->repeats, 0);
+      if (n) { site_notice(site, "last message repeated %llu times", n); }
+    }
+    return true;
+  }
+  uint64_t n = atomic_exchange64(&site->repeats, 0);
+  if (n) { site_notice(site, "last message repeated %llu times", n); }
+  atomic_store64(&site->reported_us, now);
+  return false;
+}
+
+
+/* Re-evaluate a call site after a level changed. */
+bool log_site_refresh(log_Site *site) {
+  unsigned generation = log_generation;
+  site->module_level = module_level(site->file);
+  if (site->module_level >= 0) {
+    site->enabled = site->level >= site->module_level;
+  } else {
+    site->enabled = text_enabled(site->level) ||
+                    (L.binary.fp && site->level >= L.binary.level) ||
+                    (L.flight.slots && site->level >= L.flight.level);
+  }
+  site->generation = generation;
+  return site->enabled;
+}
+
+
+/* Limits are applied first, so a flood costs a clock read per message.
+ * Binary sinks record the raw arguments; text is only formatted when some
+ * text sink wants the level. A module level stands in for every sink's. */
+void log_log_site(log_Site *site, const char *fmt, ...) {
+  va_list ap;
+  bool forced = site->module_level >= 0;
+  const LevelLimit *limit = &L.limits[site->level];
+  char *msg = NULL;
+  size_t len = 0;
+  if (site->level < LOG_FATAL && (limit->interval_us || limit->collapse)) {
+    uint64_t now = now_us();
+    if (limit->interval_us && !rate_allow(site, limit, now)) {
+      atomic_add64(&site->suppressed, 1);
+      hold(site);
+      return;
+    }
+    if (limit->collapse) {
+      va_start(ap, fmt);
+      msg = format_body(fmt, ap, &len);
+      va_end(ap);
+      if (collapse_repeat(site, msg, len, now)) { return; }
+    }
+    uint64_t n = atomic_exchange64(&site->suppressed, 0);
+    if (n) { site_notice(site, "%llu messages from here were rate limited", n); }
+  }
+
+  if (L.flight.slots && site->level >= L.flight.level) {
+    va_start(ap, fmt);
+    flight_record(site, fmt, ap);
+    va_end(ap);
+  }
+  if (L.binary.fp && (forced || site->level >= L.binary.level)) {
+    va_start(ap, fmt);
+    binary_record(site, fmt, ap);
+    va_end(ap);
+    if (site->level == LOG_FATAL) { log_binary_flush(); }
+  }
+  if (forced || text_enabled(site->level)) {
+    if (msg) {
+      emit(site->level, site->file, site->line, forced, msg, len);
+    } else {
+      va_start(ap, fmt);
+      logv(site->level, site->file, site->line, forced, fmt, ap);
+      va_end(ap);
+    }
+  }
+  if (site->level == LOG_FATAL) { log_flight_dump(); }
+}
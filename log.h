@@ -11,6 +11,7 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <time.h>
 
 #define LOG_VERSION "0.1.0"
@@ -23,27 +24,183 @@ typedef struct {
   void *udata;
   int line;
   int level;
+  bool forced;      /* a module level let it past the sink levels */
+  const char *msg;        /* body, formatted once; fmt is "%s" with it as ap */
+  size_t msg_len;
+  const char *timestamp;  /* "YYYY-mm-dd HH:MM:SS", cached per second */
+  uint64_t time_us;       /* unix time in microseconds */
+  const char *request_id; /* see log_set_request, NULL outside a request */
+  long long latency_us;
 } log_Event;
 
 typedef void (*log_LogFn)(log_Event *ev);
 typedef void (*log_LockFn)(bool lock, void *udata);
 
+/* Async mode: callers format into a lock-free ring and a writer thread feeds
+ * the sinks in batches, flushing each once per batch. Bodies longer than
+ * LOG_ASYNC_MSG_SIZE are truncated. */
+#ifndef LOG_ASYNC_MSG_SIZE
+#define LOG_ASYNC_MSG_SIZE 480
+#endif
+
+/* Each body is formatted once, into a per-thread buffer of LOG_MSG_SIZE
+ * bytes (a longer one is truncated), and every sink is handed that
+ * text, so adding sinks does not add formatting work. */
+#ifndef LOG_MSG_SIZE
+#define LOG_MSG_SIZE 4096
+#endif
+
+#ifndef LOG_FLUSH_TIMEOUT_MS
+#define LOG_FLUSH_TIMEOUT_MS 2000
+#endif
+
 enum { LOG_TRACE, LOG_DEBUG, LOG_INFO, LOG_WARN, LOG_ERROR, LOG_FATAL };
 
-#define log_trace(...) log_log(LOG_TRACE, __FILE__, __LINE__, __VA_ARGS__)
-#define log_debug(...) log_log(LOG_DEBUG, __FILE__, __LINE__, __VA_ARGS__)
-#define log_info(...)  log_log(LOG_INFO,  __FILE__, __LINE__, __VA_ARGS__)
-#define log_warn(...)  log_log(LOG_WARN,  __FILE__, __LINE__, __VA_ARGS__)
-#define log_error(...) log_log(LOG_ERROR, __FILE__, __LINE__, __VA_ARGS__)
-#define log_fatal(...) log_log(LOG_FATAL, __FILE__, __LINE__, __VA_ARGS__)
+/* Calls below LOG_COMPILE_LEVEL are compiled out, arguments and all, e.g.
+ * -DLOG_COMPILE_LEVEL=LOG_DEBUG drops every log_trace. */
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_TRACE
+#endif
+
+/* Every log statement owns a static call site, so per-site state (the binary
+ * log's site id, whether the site is enabled) costs nothing to look up.
+ * Whether a site is enabled is cached until a level changes, so a disabled
+ * call is two loads and a branch; its arguments are never evaluated. */
+typedef struct log_Site {
+  const char *file;
+  int line;
+  int level;
+  volatile unsigned id;   /* binary log site id, 0 until first written */
+  volatile unsigned generation;   /* log_generation when enabled was cached */
+  volatile bool enabled;
+  int module_level;       /* level set for the file's module, or -1 */
+  /* Rate limiting and collapsing, see log_set_rate_limit */
+  volatile uint64_t next_allowed_us;  /* token bucket, kept as the time it refills */
+  volatile uint64_t suppressed;
+  volatile uint64_t last_hash;
+  volatile uint64_t repeats;
+  volatile uint64_t reported_us;
+  struct log_Site *next_held;         /* sites that may have counts to report */
+  volatile bool held;
+} log_Site;
+
+extern volatile unsigned log_generation;
+
+#define log_at(lvl, ...) do { \
+    if ((lvl) >= LOG_COMPILE_LEVEL) { \
+      static log_Site log_site = { .file = __FILE__, .line = __LINE__, .level = lvl, .module_level = -1 }; \
+      if (log_site.generation == log_generation ? log_site.enabled \
+                                                : log_site_refresh(&log_site)) { \
+        log_log_site(&log_site, __VA_ARGS__); \
+      } \
+    } \
+  } while (0)
+
+#define log_trace(...) log_at(LOG_TRACE, __VA_ARGS__)
+#define log_debug(...) log_at(LOG_DEBUG, __VA_ARGS__)
+#define log_info(...)  log_at(LOG_INFO,  __VA_ARGS__)
+#define log_warn(...)  log_at(LOG_WARN,  __VA_ARGS__)
+#define log_error(...) log_at(LOG_ERROR, __VA_ARGS__)
+#define log_fatal(...) log_at(LOG_FATAL, __VA_ARGS__)
 
 const char* log_level_string(int level);
+int log_level_from_string(const char *name);
 void log_set_lock(log_LockFn fn, void *udata);
 void log_set_level(int level);
 void log_set_quiet(bool enable);
+/* Module levels apply to the files whose name, without directory and
+ * extension, is `module` ("obs" for obs.c). They replace every sink's level
+ * for those files, so one module can be traced on its own. A negative level
+ * removes the override. */
+int log_set_module_level(const char *module, int level);
+
+/* Per call site limits, set per level; FATAL is never held back. A site may
+ * log `burst` messages at once and `per_second` on average (a token bucket);
+ * messages over the limit are counted and the count is logged with the next
+ * one that gets through. With collapsing, a message identical to the site's
+ * previous one is only counted; "last message repeated N times" is logged
+ * when the text changes, every LOG_REPEAT_REPORT_MS, and at exit. */
+#ifndef LOG_REPEAT_REPORT_MS
+#define LOG_REPEAT_REPORT_MS 30000
+#endif
+
+int log_set_rate_limit(int level, int per_second, int burst);
+int log_set_collapse(int level, bool enable);
 int log_add_callback(log_LogFn fn, void *udata, int level);
 int log_add_fp(FILE *fp, int level);
 
+int log_async_start(int slots, int reserve_level);
+void log_async_stop(void);
+bool log_flush(void);
+unsigned long long log_async_dropped(void);
+
+/* Binary mode: record site id, time and raw arguments instead of text, for
+ * decoding later with log_decode. Each thread fills its own buffer of
+ * LOG_BINARY_BUFFER_SIZE bytes, written out as one chunk when full, on a FATAL
+ * message, on log_binary_flush and at exit. */
+#ifndef LOG_BINARY_BUFFER_SIZE
+#define LOG_BINARY_BUFFER_SIZE (64 * 1024)
+#endif
+
+int log_add_binary(const char *path, int level);
+void log_binary_flush(void);
+
+/* Mapped file sink: lines are copied straight into a preallocated,
+ * memory-mapped file, so there is no write call per line and whatever was
+ * logged survives the process crashing. A file that cannot take the next line
+ * is rotated to path.1 (path.2, ... keeping at most `keep`) and synced and
+ * trimmed to its contents on a background thread; disk use stays below
+ * (keep + 1) * max_size. With rotate_on_open, a non-empty file left by the
+ * previous run is rotated first, giving one file per session. */
+int log_add_mapped(const char *path, int level, size_t max_size, int keep, bool rotate_on_open);
+
+/* JSON sink: one object per line with fixed fields, then the context fields
+ * in the order they were first set:
+ *   {"ts_us":...,"level":"INFO","src":"obs.c:42","msg":"...",
+ *    "request_id":null,"latency_us":null, <context fields>}
+ * Lines are built in the sink's own buffer and written with one call; bodies
+ * are cut to fit LOG_JSON_LINE_SIZE. */
+#ifndef LOG_JSON_LINE_SIZE
+#define LOG_JSON_LINE_SIZE (16 * 1024)
+#endif
+
+#ifndef LOG_REQUEST_ID_SIZE
+#define LOG_REQUEST_ID_SIZE 48
+#endif
+
+int log_add_json(FILE *fp, int level);
+/* Context fields go on every JSON line. Set each one early, NULL for "not
+ * known yet", so every line has the same fields. */
+int log_set_field(const char *key, const char *value);
+int log_set_field_int(const char *key, long long value);
+/* Tag this thread's messages with a request until cleared with NULL. A
+ * negative latency is written as null. */
+void log_set_request(const char *request_id, long long latency_us);
+
+/* Flight recorder: keeps the last `slots` log events at or above `level`,
+ * plus log_flight notes, in a lock-free ring of raw arguments (as in the
+ * binary log), cheap enough to leave on at TRACE. The ring is written to
+ * path in the binary log format, for log_decode, on a FATAL message, a crash
+ * (fault or abort), a termination signal and log_flight_dump. Writing it only
+ * takes open/write/close, so it is safe in a signal handler. A record that
+ * does not fit in LOG_FLIGHT_RECORD_SIZE loses its last arguments. */
+#ifndef LOG_FLIGHT_RECORD_SIZE
+#define LOG_FLIGHT_RECORD_SIZE 256
+#endif
+
+#define log_flight(...) do { \
+    static log_Site log_site = { .file = __FILE__, .line = __LINE__, .level = LOG_TRACE, .module_level = -1 }; \
+    log_flight_site(&log_site, __VA_ARGS__); \
+  } while (0)
+
+int log_flight_start(const char *path, int slots, int level);
+void log_flight_dump(void);
+bool log_flight_active(void);
+void log_flight_site(log_Site *site, const char *fmt, ...);
+
 void log_log(int level, const char *file, int line, const char *fmt, ...);
+void log_logv(int level, const char *file, int line, const char *fmt, va_list ap);
+void log_log_site(log_Site *site, const char *fmt, ...);
+bool log_site_refresh(log_Site *site);
 
 #endif
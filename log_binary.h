@@ -0,0 +1,87 @@
+/**
+ * Binary log format shared by log.c and the log_decode tool.
+ *
+ * The file starts with the "SGRLOG" magic, a version byte and a reserved
+ * byte. Records follow, each starting with a tag byte:
+ *   'S' site   u32 id, u8 level, u32 line, u16 file length, file,
+ *              u16 format length, format
+ *   'E' event  u32 site id, u64 unix time in microseconds, u16 argument
+ *              bytes, arguments
+ * A site is written before the first event that refers to it. Events from
+ * different threads arrive in per-thread chunks, so they are only ordered by
+ * their timestamps. Arguments follow the format's conversions in order:
+ * '*' widths and integers as 8 bytes, floating point as an 8-byte double,
+ * pointers as 8 bytes, strings as u16 length + bytes. All fields are
+ * little-endian (host order on every supported target).
+ */
+
+#ifndef LOG_BINARY_H
+#define LOG_BINARY_H
+
+#include <stdbool.h>
+#include <string.h>
+
+#define LOG_BINARY_MAGIC "SGRLOG"
+#define LOG_BINARY_VERSION 1
+
+/* Longest string argument kept; longer ones are cut. */
+#ifndef LOG_BINARY_MAX_STRING
+#define LOG_BINARY_MAX_STRING 1024
+#endif
+
+/* Upper bound of one encoded event; arguments past it are not recorded. */
+#ifndef LOG_BINARY_MAX_RECORD
+#define LOG_BINARY_MAX_RECORD 4096
+#endif
+
+enum {
+  LOG_ARG_NONE,     /* "%%" or "%n" */
+  LOG_ARG_INT,
+  LOG_ARG_UINT,
+  LOG_ARG_DOUBLE,
+  LOG_ARG_STRING,
+  LOG_ARG_POINTER
+};
+
+/* One printf conversion: spec points at the '%', len covers it all. */
+typedef struct {
+  const char *spec;
+  int len;
+  int stars;        /* '*' widths/precisions, each an int argument */
+  int kind;
+  char length[3];   /* "", "hh", "h", "l", "ll", "z", "j", "t", "L" */
+  char conv;
+} log_Conversion;
+
+/* Find the next conversion at or after p. Returns false at the end. */
+static inline bool log_next_conversion(const char **p, log_Conversion *c) {
+  const char *s = strchr(*p, '%');
+  if (!s) { return false; }
+  const char *q = s + 1;
+  memset(c, 0, sizeof(*c));
+  c->spec = s;
+  while (*q && strchr("-+ #0", *q)) { q++; }
+  while (*q == '*' || (*q >= '0' && *q <= '9')) { c->stars += *q == '*'; q++; }
+  if (*q == '.') {
+    q++;
+    while (*q == '*' || (*q >= '0' && *q <= '9')) { c->stars += *q == '*'; q++; }
+  }
+  int n = 0;
+  while (*q && strchr("hljztL", *q) && n < 2) { c->length[n++] = *q++; }
+  c->conv = *q;
+  if (*q) { q++; }
+  c->len = (int) (q - s);
+  switch (c->conv) {
+    case 'd': case 'i': case 'c': c->kind = LOG_ARG_INT; break;
+    case 'u': case 'x': case 'X': case 'o': c->kind = LOG_ARG_UINT; break;
+    case 'f': case 'F': case 'e': case 'E':
+    case 'g': case 'G': case 'a': case 'A': c->kind = LOG_ARG_DOUBLE; break;
+    case 's': c->kind = LOG_ARG_STRING; break;
+    case 'p': c->kind = LOG_ARG_POINTER; break;
+    default: c->kind = LOG_ARG_NONE; break;
+  }
+  *p = q;
+  return true;
+}
+
+#endif
@@ -0,0 +1,312 @@
+// === Includes ===
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "log.h"
+#include "log_binary.h"
+#include "types.h"
+
+// Turns a binary log (log_binary_path) back into the text that file_callback
+// writes: "YYYY-mm-dd HH:MM:SS LEVEL file:line: message".
+//   log_decode <binary log> [output]
+
+// === Globals ===
+typedef struct DecodedSite {
+	bool defined;
+	u8 level;
+	u32 line;
+	const char* file;	// NUL-terminated copies owned by the decoder
+	const char* fmt;
+} DecodedSite;
+
+typedef struct DecodedEvent {
+	u64 time_us;
+	u64 order;			// file position, keeps same-time events stable
+	u32 site;
+	const u8* args;
+	u32 args_len;
+} DecodedEvent;
+
+typedef struct DecodeState {
+	DecodedSite* sites;
+	u32 site_capacity;
+	DecodedEvent* events;
+	u64 event_count;
+	u64 event_capacity;
+} DecodeState;
+
+// === Reading ===
+static u64 get_le(const u8* p, i32 bytes) {
+	u64 v = 0;
+	for (i32 i = bytes - 1; i >= 0; --i)
+		v = (v << 8) | p[i];
+	return v;
+}
+
+static u8* read_whole_file(const char* path, u64* size) {
+	FILE* fp = fopen(path, "rb");
+	if (!fp)
+		return NULL;
+	fseek(fp, 0, SEEK_END);
+	long len = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	u8* data = len >= 0 ? malloc((u64)len + 1) : NULL;
+	if (data)
+		*size = fread(data, 1, (u64)len, fp);
+	fclose(fp);
+	return data;
+}
+
+static char* copy_string(const u8* p, u64 len) {
+	char* s = malloc(len + 1);
+	if (s) {
+		memcpy(s, p, len);
+		s[len] = '\0';
+	}
+	return s;
+}
+
+static i32 add_site(DecodeState* state, u32 id, u8 level, u32 line, char* file, char* fmt) {
+	if (id >= state->site_capacity) {
+		u32 capacity = state->site_capacity ? state->site_capacity : 64;
+		while (capacity <= id)
+			capacity *= 2;
+		DecodedSite* grown = realloc(state->sites, (u64)capacity * sizeof(DecodedSite));
+		if (!grown)
+			return 1;
+		memset(grown + state->site_capacity, 0, (u64)(capacity - state->site_capacity) * sizeof(DecodedSite));
+		state->sites = grown;
+		state->site_capacity = capacity;
+	}
+	DecodedSite* site = &state->sites[id];
+	site->defined = true;
+	site->level = level;
+	site->line = line;
+	site->file = file;
+	site->fmt = fmt;
+	return 0;
+}
+
+static i32 add_event(DecodeState* state, const DecodedEvent* event) {
+	if (state->event_count == state->event_capacity) {
+		u64 capacity = state->event_capacity ? state->event_capacity * 2 : 4096;
+		DecodedEvent* grown = realloc(state->events, capacity * sizeof(DecodedEvent));
+		if (!grown)
+			return 1;
+		state->events = grown;
+		state->event_capacity = capacity;
+	}
+	state->events[state->event_count++] = *event;
+	return 0;
+}
+
+// Returns 0 when the whole file parsed; a torn final record is ignored.
+static i32 parse_records(DecodeState* state, const u8* data, u64 size) {
+	u64 pos = 8;
+	while (pos < size) {
+		u8 tag = data[pos];
+		if (tag == 'S') {
+			if (size - pos < 12)
+				break;
+			u32 id = (u32)get_le(data + pos + 1, 4);
+			u8 level = data[pos + 5];
+			u32 line = (u32)get_le(data + pos + 6, 4);
+			u64 file_len = get_le(data + pos + 10, 2);
+			if (size - pos < 12 + file_len + 2)
+				break;
+			u64 fmt_len = get_le(data + pos + 12 + file_len, 2);
+			if (size - pos < 14 + file_len + fmt_len)
+				break;
+			char* file = copy_string(data + pos + 12, file_len);
+			char* fmt = copy_string(data + pos + 14 + file_len, fmt_len);
+			if (!file || !fmt || add_site(state, id, level > LOG_FATAL ? LOG_FATAL : level, line, file, fmt))
+				return 1;
+			pos += 14 + file_len + fmt_len;
+		} else if (tag == 'E') {
+			if (size - pos < 15)
+				break;
+			DecodedEvent event;
+			event.site = (u32)get_le(data + pos + 1, 4);
+			event.time_us = get_le(data + pos + 5, 8);
+			event.args_len = (u32)get_le(data + pos + 13, 2);
+			event.args = data + pos + 15;
+			event.order = pos;
+			if (size - pos < 15 + (u64)event.args_len)
+				break;
+			if (add_event(state, &event))
+				return 1;
+			pos += 15 + event.args_len;
+		} else {
+			fprintf(stderr, "unknown record tag 0x%02x at offset %llu\n", tag, pos);
+			return 1;
+		}
+	}
+	if (pos < size)
+		fprintf(stderr, "ignoring %llu bytes of a truncated record\n", size - pos);
+	return 0;
+}
+
+static i32 compare_events(const void* a, const void* b) {
+	const DecodedEvent* x = a;
+	const DecodedEvent* y = b;
+	if (x->time_us != y->time_us)
+		return x->time_us < y->time_us ? -1 : 1;
+	return x->order < y->order ? -1 : x->order > y->order;
+}
+
+// === Formatting ===
+// Rebuild one conversion with the length modifier the stored value needs.
+static void conversion_spec(const log_Conversion* c, const char* length, char* spec, u64 spec_size) {
+	u64 n = 0;
+	for (i32 i = 0; i < c->len - 1 && n + 4 < spec_size; ++i) {
+		char ch = c->spec[i];
+		if (i > 0 && strchr("hljztL", ch))
+			continue;
+		spec[n++] = ch;
+	}
+	for (const char* l = length; *l && n + 2 < spec_size; ++l)
+		spec[n++] = *l;
+	spec[n++] = c->conv;
+	spec[n] = '\0';
+}
+
+static u64 append(char* out, u64 room, const char* text) {
+	u64 len = strlen(text);
+	if (len >= room)
+		len = room - 1;
+	memcpy(out, text, len);
+	out[len] = '\0';
+	return len;
+}
+
+// Replays the format against the recorded arguments.
+static void format_message(const DecodedSite* site, const DecodedEvent* event, char* out, u64 out_size) {
+	const u8* p = event->args;
+	const u8* end = event->args + event->args_len;
+	const char* f = site->fmt;
+	u64 n = 0;
+	log_Conversion c;
+	while (n + 1 < out_size) {
+		const char* before = f;
+		bool found = log_next_conversion(&f, &c);
+		const char* literal_end = found ? c.spec : before + strlen(before);
+		u64 literal = (u64)(literal_end - before);
+		if (literal > out_size - 1 - n)
+			literal = out_size - 1 - n;
+		memcpy(out + n, before, literal);
+		n += literal;
+		if (!found)
+			break;
+
+		i32 stars[2] = { 0, 0 };
+		for (i32 i = 0; i < c.stars; ++i) {
+			if (end - p >= 8 && i < 2)
+				stars[i] = (i32)(i64)get_le(p, 8);
+			p += end - p >= 8 ? 8 : 0;
+		}
+		char spec[32];
+		u64 room = out_size - n;
+		if (c.kind == LOG_ARG_NONE) {
+			if (c.conv == '%' && room > 1)
+				out[n++] = '%';
+			continue;
+		}
+		// Arguments past LOG_BINARY_MAX_RECORD were not recorded.
+		if (end - p < (c.kind == LOG_ARG_STRING ? 2 : 8)) {
+			n += append(out + n, room, "?");
+			continue;
+		}
+		char buf[LOG_BINARY_MAX_STRING * 2];
+		i32 len;
+		u64 v = get_le(p, c.kind == LOG_ARG_STRING ? 2 : 8);
+		if (c.kind == LOG_ARG_STRING) {
+			if ((u64)(end - p - 2) < v)
+				v = (u64)(end - p - 2);
+			char* str = copy_string(p + 2, v);
+			p += 2 + v;
+			if (!str)
+				continue;
+			conversion_spec(&c, "", spec, sizeof(spec));
+			len = c.stars == 0 ? snprintf(buf, sizeof(buf), spec, str)
+				: c.stars == 1 ? snprintf(buf, sizeof(buf), spec, stars[0], str)
+				: snprintf(buf, sizeof(buf), spec, stars[0], stars[1], str);
+			free(str);
+		} else if (c.kind == LOG_ARG_DOUBLE) {
+			p += 8;
+			double d;
+			memcpy(&d, &v, sizeof(d));
+			conversion_spec(&c, "", spec, sizeof(spec));
+			len = c.stars == 0 ? snprintf(buf, sizeof(buf), spec, d)
+				: c.stars == 1 ? snprintf(buf, sizeof(buf), spec, stars[0], d)
+				: snprintf(buf, sizeof(buf), spec, stars[0], stars[1], d);
+		} else if (c.kind == LOG_ARG_POINTER) {
+			p += 8;
+			conversion_spec(&c, "", spec, sizeof(spec));
+			len = c.stars == 0 ? snprintf(buf, sizeof(buf), spec, (void*)(uintptr_t)v)
+				: snprintf(buf, sizeof(buf), spec, stars[0], (void*)(uintptr_t)v);
+		} else if (c.conv == 'c') {
+			p += 8;
+			conversion_spec(&c, "", spec, sizeof(spec));
+			len = c.stars == 0 ? snprintf(buf, sizeof(buf), spec, (i32)v)
+				: snprintf(buf, sizeof(buf), spec, stars[0], (i32)v);
+		} else {
+			// Integers were widened to 64 bits when recorded.
+			p += 8;
+			conversion_spec(&c, "ll", spec, sizeof(spec));
+			len = c.stars == 0 ? snprintf(buf, sizeof(buf), spec, (long long)v)
+				: c.stars == 1 ? snprintf(buf, sizeof(buf), spec, stars[0], (long long)v)
+				: snprintf(buf, sizeof(buf), spec, stars[0], stars[1], (long long)v);
+		}
+		if (len > 0)
+			n += append(out + n, room, buf);
+	}
+	out[n] = '\0';
+}
+
+// === Entry point ===
+i32 main(i32 argc, char* argv[]) {
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <binary log> [output]\n", argv[0]);
+		return 1;
+	}
+	u64 size = 0;
+	u8* data = read_whole_file(argv[1], &size);
+	if (!data || size < 8 || memcmp(data, LOG_BINARY_MAGIC, 6) != 0 || data[6] != LOG_BINARY_VERSION) {
+		fprintf(stderr, "%s is not a version %d binary log\n", argv[1], LOG_BINARY_VERSION);
+		return 1;
+	}
+	FILE* out = argc > 2 ? fopen(argv[2], "w") : stdout;
+	if (!out) {
+		fprintf(stderr, "could not open %s\n", argv[2]);
+		return 1;
+	}
+
+	DecodeState state = { 0 };
+	if (parse_records(&state, data, size)) {
+		fprintf(stderr, "could not decode %s\n", argv[1]);
+		return 1;
+	}
+	// Per-thread chunks interleave out of order; timestamps restore it.
+	qsort(state.events, state.event_count, sizeof(DecodedEvent), compare_events);
+
+	static char message[64 * 1024];
+	for (u64 i = 0; i < state.event_count; ++i) {
+		const DecodedEvent* event = &state.events[i];
+		if (event->site >= state.site_capacity || !state.sites[event->site].defined) {
+			fprintf(stderr, "event for unknown site %u skipped\n", event->site);
+			continue;
+		}
+		const DecodedSite* site = &state.sites[event->site];
+		format_message(site, event, message, sizeof(message));
+		time_t seconds = (time_t)(event->time_us / 1000000);
+		char stamp[64];
+		stamp[strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", localtime(&seconds))] = '\0';
+		fprintf(out, "%s %-5s %s:%u: %s\n", stamp, log_level_string(site->level), site->file, site->line, message);
+	}
+
+	if (out != stdout)
+		fclose(out);
+	return 0;
+}
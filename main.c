@@ -1,17 +1,22 @@
 // === Includes ===
+#include "config.h"
 #include "game_launcher.h"
+#include "idle_detector.h"
 #include "mongoose.h"
 #include "obs.h"
+#include "obs_capture.h"
+#include "obs_pool.h"
+#include "platform.h"
+#include "resource_sampler.h"
+#include "scene_rules.h"
+#include "steam_library.h"
 #include "types.h"
-#include <windows.h>
-#include <shellapi.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <tlhelp32.h>
-#include <wchar.h>
 #include "path.h"
+#include "placement.h"
 
 
 
@@ -21,30 +26,7 @@
 // === OBS helpers ===
 // Check for an existing OBS process by executable name.
 i32 is_obs_process_running(bool* is_running) {
-	HANDLE process_snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
-	if (process_snapshot == INVALID_HANDLE_VALUE) {
-		return 1;
-	}
-
-	PROCESSENTRY32 process_entry;
-	process_entry.dwSize = sizeof(PROCESSENTRY32);
-
-	if (!Process32First(process_snapshot, &process_entry)) {
-		CloseHandle(process_snapshot);
-		return 1;
-	}
-
-	bool obs_found = false;
-	do {
-		if (wcscmp(process_entry.szExeFile, L"obs64.exe") == 0) {
-			obs_found = true;
-			break;
-		}
-	} while (Process32Next(process_snapshot, &process_entry));
-
-	CloseHandle(process_snapshot);
-	*is_running = obs_found;
-	return 0;
+	return platform_is_process_running(OBS_EXE_NAME, is_running);
 }
 
 // Launch OBS if it is not already running.
@@ -59,20 +41,19 @@ i32 launch_obs(const char* game_name) {
 	if (is_running)
 		return 0;
 
-	char* obs_working_dir = "C:\\Program Files\\obs-studio\\bin\\64bit";
+	const char* obs_working_dir = OBS_EXE_DIR;
 	char obs_exe_path[128];
 	strcpy_s(obs_exe_path, 128, obs_working_dir);
-	strcat_s(obs_exe_path, 128, "\\obs64.exe");
+	strcat_s(obs_exe_path, 128, "/" OBS_EXE_NAME);
 
-	HINSTANCE result = ShellExecuteA(NULL, "open", obs_exe_path, "--minimize-to-tray", obs_working_dir, SW_SHOWNORMAL);
-	if ((intptr_t)result > 32) {
+	if (platform_launch_detached(obs_exe_path, "--minimize-to-tray", obs_working_dir) == 0) {
 		printf("OBS launched successfully.\n");
 	} else {
-		printf("ERROR: failed to launch OBS (code: %Id).\n", (intptr_t)result);
+		printf("ERROR: failed to launch OBS.\n");
 		return 1;
 	}
 
-	Sleep(10000);	// Wait for OBS to fully started.
+	platform_sleep_ms(10000);	// Wait for OBS to fully started.
 	return 0;
 }
 
@@ -93,6 +74,155 @@ i32 launch_obs(const char* game_name) {
 //	system(command_line);
 //}
 
+// Configure logging from the config file:
+//   log_level = INFO          stderr level
+//   log_modules = obs:TRACE, path:WARN
+//                             per-file levels that replace the sink levels
+//   log_binary_path = <file>  also record a binary log for log_decode
+//   log_binary_level = DEBUG  lowest level kept in the binary log
+//   log_file_path = <file>    write a memory-mapped, rotated log file
+//   log_file_level = DEBUG    lowest level kept in the log file
+//   log_file_max_mb = 16      size each file is preallocated to and rotated at
+//   log_file_keep = 5         rotated files kept as <file>.1 ... <file>.N
+//   log_file_rotate = size    or "session" to also start a new file every run
+//   log_json_path = <file>    also append NDJSON lines with session, scene,
+//                             game_pid and OBS request fields
+//   log_json_level = DEBUG    lowest level kept in the JSON log
+//   log_flight_slots = 4096   last events kept in memory for a crash dump (0 disables)
+//   log_flight_level = TRACE  lowest level the flight recorder keeps
+//   log_flight_path = <file>  where the dump goes, for log_decode
+//                             (default <temp dir>/smart_grecording.flight)
+//   log_rate_limit = INFO:20/100, DEBUG:50/200
+//                             per call site: messages per second / burst
+//   log_collapse = INFO, WARN, ERROR
+//                             levels whose identical repeats are only counted
+//   log_async = true          queue messages for a background writer thread
+//   log_async_slots = 4096    ring size; bodies are truncated to LOG_ASYNC_MSG_SIZE
+//   log_async_reserve = WARN  messages below this level are dropped first when the ring fills
+static i32 config_log_level(const char* key, i32 fallback) {
+	const char* name = config_get_str(key, NULL);
+	if (!name || !*name)
+		return fallback;
+	i32 level = log_level_from_string(name);
+	if (level < 0) {
+		log_warn("config '%s' is not a log level: %s", key, name);
+		return fallback;
+	}
+	return level;
+}
+
+// Calls fn for each entry of a list separated by commas or spaces.
+static void for_each_config_entry(const char* list, void (*fn)(char* entry)) {
+	while (*list) {
+		u64 len = strcspn(list, ", \t");
+		if (len > 0) {
+			char entry[64];
+			snprintf(entry, sizeof(entry), "%.*s", (i32)len, list);
+			fn(entry);
+		}
+		list += len;
+		if (*list)
+			++list;
+	}
+}
+
+// log_modules entry: module:LEVEL
+static void setup_module_level(char* entry) {
+	char* colon = strchr(entry, ':');
+	i32 level = colon ? log_level_from_string(colon + 1) : -1;
+	if (level < 0) {
+		log_warn("log_modules entry is not module:LEVEL: %s", entry);
+		return;
+	}
+	*colon = '\0';
+	if (log_set_module_level(entry, level) != 0)
+		log_warn("could not set the log level of module %s", entry);
+}
+
+// log_rate_limit entry: LEVEL:per_second/burst
+static void setup_rate_limit(char* entry) {
+	char* colon = strchr(entry, ':');
+	i32 per_second = 0;
+	i32 burst = 0;
+	if (colon) {
+		*colon = '\0';
+		if (sscanf(colon + 1, "%d/%d", &per_second, &burst) < 1)
+			per_second = 0;
+	}
+	i32 level = log_level_from_string(entry);
+	if (level < 0 || per_second <= 0) {
+		log_warn("log_rate_limit entry is not LEVEL:per_second/burst: %s", entry);
+		return;
+	}
+	log_set_rate_limit(level, per_second, burst > 0 ? burst : per_second);
+}
+
+// log_collapse entry: LEVEL
+static void setup_collapse(char* entry) {
+	i32 level = log_level_from_string(entry);
+	if (level < 0) {
+		log_warn("log_collapse entry is not a log level: %s", entry);
+		return;
+	}
+	log_set_collapse(level, true);
+}
+
+void setup_logging(void) {
+	log_set_level(config_log_level("log_level", LOG_TRACE));
+	for_each_config_entry(config_get_str("log_modules", ""), setup_module_level);
+
+	const char* binary_path = config_get_str("log_binary_path", NULL);
+	if (binary_path && *binary_path && log_add_binary(binary_path, config_log_level("log_binary_level", LOG_DEBUG)) != 0)
+		log_warn("could not open binary log %s", binary_path);
+
+	const char* file_path = config_get_str("log_file_path", NULL);
+	if (file_path && *file_path) {
+		u64 max_size = (u64)config_get_int("log_file_max_mb", 16) * 1024 * 1024;
+		i32 keep = (i32)config_get_int("log_file_keep", 5);
+		bool per_session = strcmp(config_get_str("log_file_rotate", "size"), "session") == 0;
+		if (log_add_mapped(file_path, config_log_level("log_file_level", LOG_DEBUG), max_size, keep, per_session) != 0)
+			log_warn("could not open log file %s", file_path);
+	}
+
+	const char* json_path = config_get_str("log_json_path", NULL);
+	if (json_path && *json_path) {
+		FILE* json = fopen(json_path, "a");
+		if (!json || log_add_json(json, config_log_level("log_json_level", LOG_DEBUG)) != 0) {
+			log_warn("could not open JSON log %s", json_path);
+			if (json)
+				fclose(json);
+		}
+	}
+	// Every JSON line carries the same fields; scene and game_pid fill in later.
+	char session_id[17];
+	log_set_field("session", mg_random_str(session_id, sizeof(session_id)));
+	log_set_field("scene", NULL);
+	log_set_field("game_pid", NULL);
+
+	// The flight recorder stays on unless log_flight_slots = 0.
+	i32 flight_slots = (i32)config_get_int("log_flight_slots", 4096);
+	if (flight_slots > 0) {
+		char flight_path[1024];
+		const char* path = config_get_str("log_flight_path", NULL);
+		if (path && *path)
+			snprintf(flight_path, sizeof(flight_path), "%s", path);
+		else if (platform_temp_dir(flight_path, sizeof(flight_path)) == 0)
+			snprintf(flight_path + strlen(flight_path), sizeof(flight_path) - strlen(flight_path), "/smart_grecording.flight");
+		if (log_flight_start(flight_path, flight_slots, config_log_level("log_flight_level", LOG_TRACE)) != 0)
+			log_warn("could not start the flight recorder");
+	}
+
+	// Registered after the sinks, so held counts are reported before they close.
+	for_each_config_entry(config_get_str("log_rate_limit", ""), setup_rate_limit);
+	for_each_config_entry(config_get_str("log_collapse", ""), setup_collapse);
+
+	if (!config_get_bool("log_async", false))
+		return;
+	i32 slots = (i32)config_get_int("log_async_slots", 4096);
+	if (log_async_start(slots, config_log_level("log_async_reserve", LOG_WARN)) != 0)
+		log_warn("could not start the log writer thread; logging synchronously");
+}
+
 // Log CLI arguments for debugging.
 void log_cli_args(i32 argc, char* argv[]) {
 	for (i32 i = 1; i < argc; ++i) {
@@ -100,6 +230,304 @@ void log_cli_args(i32 argc, char* argv[]) {
 	}
 }
 
+// === Recording policy ===
+// record_start = immediate starts before launch; on_game waits for the game process.
+typedef struct RecordingState {
+	bool deferred;
+	bool started;
+	bool idle_pause;
+	bool paused;
+	IdleDetector idle;
+	PlacementPolicy placement;
+	u32 idle_sample_ms;
+	u32 resource_sample_ms;
+	u32 tick_ms;
+	u64 next_idle_us;
+	u64 next_resource_us;
+} RecordingState;
+
+// The recording output's start, as OBS reports it, is time zero of the
+// resource sidecar.
+i32 start_recording(RecordingState* state) {
+	u64 started_us;
+	i32 err = obs_start_recording(&started_us);
+	if (err)
+		return err;
+	state->started = true;
+	resource_sampler_start(started_us);
+	// The encoder/muxer processes only exist once the output is running.
+	placement_apply_obs(&state->placement);
+	return 0;
+}
+
+void start_recording_on_game(i64 pid, void* udata) {
+	RecordingState* state = udata;
+	log_set_field_int("game_pid", pid);
+	if (state->started)
+		return;
+	log_info("game process %lld detected; starting recording", pid);
+	if (start_recording(state))
+		log_error("could not start recording");
+}
+
+// Pause while the game is idle or suspended, resume when it is busy again.
+void pause_recording_when_idle(RecordingState* state) {
+	if (!state->started)
+		return;
+
+	u64 cpu_us;
+	bool stopped;
+	if (platform_process_tree_cpu_time(&cpu_us, &stopped))
+		return;
+
+	IdleEvent event = idle_detector_sample(&state->idle, platform_monotonic_us(), cpu_us, stopped);
+	if (event == IDLE_EVENT_IDLE && !state->paused) {
+		log_info("game is %s; pausing recording", stopped ? "suspended" : "idle");
+		if (obs_pause_recording() == 0) {
+			state->paused = true;
+			resource_sampler_pause(platform_monotonic_us());
+		}
+	} else if (event == IDLE_EVENT_ACTIVE && state->paused) {
+		log_info("game is active again; resuming recording");
+		if (obs_resume_recording() == 0) {
+			state->paused = false;
+			resource_sampler_resume(platform_monotonic_us());
+		}
+	}
+}
+
+// Idle detection and resource sampling share one tick at the shorter of the two
+// intervals. A job is due within half a tick of its deadline so tick jitter
+// never pushes it back a whole interval.
+static bool session_job_due(u64* next_us, u32 interval_ms, u32 tick_ms, u64 now_us) {
+	if (interval_ms == 0 || now_us + (u64)tick_ms * 500 < *next_us)
+		return false;
+	*next_us += (u64)interval_ms * 1000;
+	if (*next_us <= now_us)
+		*next_us = now_us + (u64)interval_ms * 1000;
+	return true;
+}
+
+void run_session_tick(void* udata) {
+	RecordingState* state = udata;
+	u64 now = platform_monotonic_us();
+	if (state->idle_pause && session_job_due(&state->next_idle_us, state->idle_sample_ms, state->tick_ms, now))
+		pause_recording_when_idle(state);
+	if (session_job_due(&state->next_resource_us, state->resource_sample_ms, state->tick_ms, now))
+		resource_sampler_sample(now);
+}
+
+// Writes <recording>.resources next to the file OBS reported.
+void write_resource_sidecar(const RecordingState* state, const char* output_path) {
+	if (!resource_sampler_is_enabled())
+		return;
+	if (!*output_path) {
+		log_warn("OBS did not report the recording path; resource samples were not saved");
+		return;
+	}
+	char sidecar_path[2048];
+	snprintf(sidecar_path, sizeof(sidecar_path), "%s%s", output_path, RESOURCE_SIDECAR_SUFFIX);
+	resource_sampler_write(sidecar_path, state->resource_sample_ms);
+}
+
+// === Scene naming ===
+// Scenes are named by the first of: a scene_rules match on the game's
+// steamapps/common folder, its store title with scene_name = steam, or the
+// folder itself.
+bool scene_names_use_store_title(void) {
+	return strcmp(config_get_str("scene_name", "folder"), "steam") == 0;
+}
+
+// A broken rules file is reported but never keeps the game from launching.
+void load_scene_rules(void) {
+	const char* path = config_get_str("scene_rules", NULL);
+	if (path && *path && scene_rules_load(path))
+		log_warn("scene rules not loaded; using folder names");
+}
+
+i32 scene_name_for_steam_game(const SteamGameInfo* game, bool store_title, char* scene_name, i32 scene_name_size) {
+	char folder[256];
+	if (extract_game_name_from_path(game->install_dir, folder, sizeof(folder)))
+		return 1;
+	if (scene_rules_resolve(folder, scene_name, (u64)scene_name_size))
+		return 0;
+	if (store_title)
+		return strcpy_s(scene_name, scene_name_size, game->name) != 0;
+	return strcpy_s(scene_name, scene_name_size, folder) != 0;
+}
+
+// === Library preparation ===
+typedef struct SceneName {
+	char name[256];
+} SceneName;
+
+typedef struct LibraryScenes {
+	bool store_title;
+	SceneName* names;
+	i32 count;
+	i32 capacity;
+} LibraryScenes;
+
+static i32 compare_scene_names(const void* a, const void* b) {
+	return strcmp(((const SceneName*)a)->name, ((const SceneName*)b)->name);
+}
+
+static i32 compare_scene_name_ptrs(const void* a, const void* b) {
+	return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+static bool collect_library_scene(const SteamGameInfo* game, void* udata) {
+	LibraryScenes* scenes = udata;
+	if (scenes->count == scenes->capacity) {
+		i32 capacity = scenes->capacity ? scenes->capacity * 2 : 256;
+		SceneName* grown = realloc(scenes->names, (u64)capacity * sizeof(SceneName));
+		if (!grown)
+			return false;
+		scenes->names = grown;
+		scenes->capacity = capacity;
+	}
+	if (scene_name_for_steam_game(game, scenes->store_title, scenes->names[scenes->count].name, sizeof(scenes->names[0].name)) == 0)
+		scenes->count++;
+	return true;
+}
+
+// Split OBS's "/a/b/" list in place into a sorted array for binary search.
+static const char** split_scene_list(char* list, i32* count) {
+	i32 capacity = 0;
+	for (char* p = list; *p; ++p)
+		capacity += *p == '/';
+	const char** names = malloc((u64)(capacity + 1) * sizeof(char*));
+	if (!names)
+		return NULL;
+	*count = 0;
+	for (char* p = list; *p; ) {
+		char* end = strchr(p, '/');
+		if (!end)
+			break;
+		*end = '\0';
+		if (end > p)
+			names[(*count)++] = p;
+		p = end + 1;
+	}
+	qsort(names, *count, sizeof(char*), compare_scene_name_ptrs);
+	return names;
+}
+
+// Names are sorted and deduplicated, then checked against the scene list with
+// one lookup each, so the cost is O(n log n) in the number of games and scenes
+// and OBS sees ceil(missing / prepare_batch_size) requests.
+i32 prepare_library_scenes(const LibraryScenes* scenes, i32* missing, i32* created) {
+	char* list;
+	i32 err = obs_get_scene_list(&list);
+	if (err)
+		return err;
+	i32 existing_count = 0;
+	const char** existing = split_scene_list(list, &existing_count);
+	if (!existing) {
+		mg_free(list);
+		return 1;
+	}
+
+	i32 batch_size = (i32)config_get_int("prepare_batch_size", 250);
+	if (batch_size < 1)
+		batch_size = 1;
+	const char** batch = malloc((u64)batch_size * sizeof(char*));
+	if (!batch) {
+		free(existing);
+		mg_free(list);
+		return 1;
+	}
+
+	*missing = 0;
+	*created = 0;
+	i32 pending = 0;
+	for (i32 i = 0; i < scenes->count && !err; ++i) {
+		const char* name = scenes->names[i].name;
+		if (i > 0 && strcmp(name, scenes->names[i - 1].name) == 0)
+			continue;
+		if (bsearch(&name, existing, existing_count, sizeof(char*), compare_scene_name_ptrs))
+			continue;
+		(*missing)++;
+		batch[pending++] = name;
+		if (pending == batch_size) {
+			i32 batch_created;
+			err = obs_create_scenes(batch, pending, &batch_created);
+			*created += batch_created;
+			pending = 0;
+		}
+	}
+	if (!err && pending > 0) {
+		i32 batch_created;
+		err = obs_create_scenes(batch, pending, &batch_created);
+		*created += batch_created;
+	}
+
+	free(batch);
+	free(existing);
+	mg_free(list);
+	return err;
+}
+
+// === Modes ===
+// Replay a recorded OBS session: --obs-replay <capture> [--max-speed]
+i32 run_obs_replay(i32 argc, char* argv[]) {
+	if (argc < 3) {
+		log_fatal("usage: %s --obs-replay <capture> [--max-speed]", argv[0]);
+		return 1;
+	}
+	bool max_speed = argc > 3 && strcmp(argv[3], "--max-speed") == 0;
+	return obs_replay_run(argv[2], max_speed);
+}
+
+// Show which pooled OBS instances are leased: --obs-pool-status
+i32 run_obs_pool_status(void) {
+	return obs_pool_report();
+}
+
+// Create a scene for every installed Steam game that lacks one: --prepare-library
+i32 run_prepare_library(void) {
+	u64 start = platform_monotonic_us();
+	load_scene_rules();
+	SteamLibraryIndex index;
+	if (steam_library_open(NULL, &index)) {
+		log_fatal("could not find any Steam library");
+		return 1;
+	}
+	LibraryScenes scenes = { scene_names_use_store_title(), NULL, 0, 0 };
+	i32 games = steam_library_for_each(&index, collect_library_scene, &scenes);
+	steam_library_close(&index);
+	qsort(scenes.names, scenes.count, sizeof(SceneName), compare_scene_names);
+
+	ObsPoolLease lease = { 0 };
+	i32 err = obs_pool_acquire(&lease);
+	if (err) {
+		log_fatal("could not lease an OBS instance");
+		goto err_free_scenes;
+	}
+	err = obs_connect(lease.url);
+	if (err) {
+		log_fatal("could not connect to OBS");
+		goto err_release_obs;
+	}
+
+	i32 missing = 0, created = 0;
+	err = prepare_library_scenes(&scenes, &missing, &created);
+	if (err)
+		log_error("could not create the missing scenes");
+	log_info("%d games, %d missing scenes, %d created in %llu ms",
+			 games, missing, created, (platform_monotonic_us() - start) / 1000);
+	if (!err && created != missing)
+		err = 1;
+
+	obs_disconnect();
+err_release_obs:
+	obs_pool_release(&lease);
+err_free_scenes:
+	free(scenes.names);
+	scene_rules_free();
+	return err;
+}
+
 // === Entry point ===
 i32 main(i32 argc, char* argv[]) {
 	log_cli_args(argc, argv);
@@ -111,13 +539,42 @@ i32 main(i32 argc, char* argv[]) {
 		goto err_suspend;
 	}
 
-	char target_scene_name[256];
-	err = extract_game_name_from_path(argv[1], target_scene_name, sizeof(target_scene_name));
+	err = config_load();
+	if (err) {
+		log_fatal("could not load config file");
+		goto err_suspend;
+	}
+	setup_logging();
+
+	if (strcmp(argv[1], "--obs-replay") == 0)
+		return run_obs_replay(argc, argv);
+	if (strcmp(argv[1], "--obs-pool-status") == 0)
+		return run_obs_pool_status();
+	if (strcmp(argv[1], "--prepare-library") == 0)
+		return run_prepare_library();
+
+	char game_folder[256], target_scene_name[256];
+	err = extract_game_name_from_path(argv[1], game_folder, sizeof(game_folder));
 	if (err) {
 		log_fatal("could not parse game name from path: %s", argv[1]);
 		goto err_suspend;
 	}
+	strcpy_s(target_scene_name, sizeof(target_scene_name), game_folder);
+	load_scene_rules();
+	if (scene_rules_resolve(game_folder, target_scene_name, sizeof(target_scene_name))) {
+		log_info("scene rule maps '%s' to '%s'", game_folder, target_scene_name);
+	} else if (scene_names_use_store_title()) {
+		// scene_name = steam names scenes after the store title instead of the folder.
+		SteamGameInfo game_info;
+		if (steam_library_lookup(argv[1], &game_info) == 0) {
+			log_info("steam app %u: %s", game_info.appid, game_info.name);
+			scene_name_for_steam_game(&game_info, true, target_scene_name, sizeof(target_scene_name));
+		} else {
+			log_warn("game is not in the Steam library index; using the folder name");
+		}
+	}
 	log_info("target scene name: %s", target_scene_name);
+	log_set_field("scene", target_scene_name);
 
 
 	/*bool running = false;
@@ -131,12 +588,19 @@ i32 main(i32 argc, char* argv[]) {
 		}
 	}*/
 
-	err = obs_connect();
+	ObsPoolLease lease = { 0 };
+	err = obs_pool_acquire(&lease);
 	if (err) {
-		log_fatal("could not connect to OBS");
+		log_fatal("could not lease an OBS instance");
 		goto err_suspend;
 	}
 
+	err = obs_connect(lease.url);
+	if (err) {
+		log_fatal("could not connect to OBS");
+		goto err_release_obs;
+	}
+
 	bool exists;
 	err = obs_scene_exists(target_scene_name, &exists);
 	if (err) {
@@ -159,29 +623,78 @@ i32 main(i32 argc, char* argv[]) {
 		goto err_free_con;
 	}
 
-	err = obs_start_recording();
-	if (err) {
-		log_fatal("could not start recording");
-		goto err_free_con;
+	RecordingState recording = { 0 };
+	placement_load(&recording.placement);
+	recording.resource_sample_ms = (u32)config_get_int("resource_sample_ms", 0);
+	if (recording.resource_sample_ms > 0) {
+		u32 ring_samples = (u32)config_get_int("resource_ring_samples", RESOURCE_RING_SAMPLES);
+		if (resource_sampler_init(ring_samples))
+			recording.resource_sample_ms = 0;
+	}
+
+	const char* record_start = config_get_str("record_start", "immediate");
+	recording.deferred = strcmp(record_start, "on_game") == 0;
+	if (!recording.deferred && strcmp(record_start, "immediate") != 0)
+		log_warn("unknown record_start '%s'; recording immediately", record_start);
+
+	if (!recording.deferred) {
+		err = start_recording(&recording);
+		if (err) {
+			log_fatal("could not start recording");
+			goto err_free_con;
+		}
+	}
+
+	// Also runs when recording already started, to tag the log with the game PID.
+	GameSessionHooks hooks = { start_recording_on_game, NULL, 0, &recording, obs_event_loop(), NULL };
+
+	recording.idle_pause = config_get_bool("idle_pause", false);
+	if (recording.idle_pause) {
+		IdleDetectorConfig idle_config = {
+			.idle_cpu_percent = (u32)config_get_int("idle_cpu_percent", 3),
+			.active_cpu_percent = (u32)config_get_int("active_cpu_percent", 10),
+			.idle_after_ms = (u32)config_get_int("idle_after_ms", 60000),
+			.active_after_ms = (u32)config_get_int("active_after_ms", 2000),
+		};
+		idle_detector_init(&recording.idle, &idle_config);
+		recording.idle_sample_ms = (u32)config_get_int("idle_sample_ms", 1000);
 	}
 
-	err = launch_target_game(argc, argv);
+	recording.tick_ms = recording.idle_pause ? recording.idle_sample_ms : 0;
+	if (recording.resource_sample_ms > 0 && (recording.tick_ms == 0 || recording.resource_sample_ms < recording.tick_ms))
+		recording.tick_ms = recording.resource_sample_ms;
+	if (recording.tick_ms > 0) {
+		hooks.on_tick = run_session_tick;
+		hooks.tick_interval_ms = recording.tick_ms;
+	}
+	err = launch_target_game(argc, argv, &recording.placement, &hooks);
 	if (err) {
 		log_fatal("could not start game");
 		goto err_free_con;
 	}
 
-	err = obs_stop_recording();
+	if (!recording.started) {
+		log_warn("game was never detected; nothing was recorded");
+		goto err_free_con;
+	}
+
+	char output_path[2048];
+	err = obs_stop_recording(output_path, sizeof(output_path));
 	if (err) {
 		log_fatal("could not stop recording; please stop it manually");
 		goto err_free_con;
 	}
+	write_resource_sidecar(&recording, output_path);
 
 err_free_con:
 	obs_disconnect();
+	resource_sampler_free();
+	scene_rules_free();
+err_release_obs:
+	obs_pool_release(&lease);
 err_suspend:
 	if (err)
-		system("pause");
+		platform_pause();
 
 	return err;
 }
@@ -4035,6 +4035,8 @@ struct mg_connection *mg_alloc_conn(struct mg_mgr *mgr) {
   if (c != NULL) {
     c->mgr = mgr;
     c->send.align = c->recv.align = c->rtls.align = MG_IO_SIZE;
+    c->wsmsg.align = MG_IO_SIZE;
+    c->max_recv = MG_MAX_RECV_SIZE;
     c->id = ++mgr->nextid;
     MG_PROF_INIT(c);
   }
@@ -4057,6 +4059,7 @@ void mg_close_conn(struct mg_connection *c) {
   mg_iobuf_free(&c->recv);
   mg_iobuf_free(&c->send);
   mg_iobuf_free(&c->rtls);
+  mg_iobuf_free(&c->wsmsg);
   mg_bzero((unsigned char *) c, sizeof(*c));
   mg_free(c);
 }
@@ -5143,7 +5146,7 @@ static bool rx_udp(struct mg_tcpip_if *ifp, struct pkt *pkt) {
     c->rem.ip4 = pkt->ip->src;
   }
   memcpy(s->mac, pkt->eth->src, sizeof(s->mac));
-  if (c->recv.len >= MG_MAX_RECV_SIZE) {
+  if (c->recv.len >= c->max_recv) {
     mg_error(c, "max_recv_buf_size reached");
   } else if (c->recv.size - c->recv.len < pkt->pay.len &&
              !mg_iobuf_resize(&c->recv, c->recv.len + pkt->pay.len)) {
@@ -5368,7 +5371,7 @@ long mg_io_send(struct mg_connection *c, const void *buf, size_t len) {
 
 static void handle_tls_recv(struct mg_connection *c) {
   size_t avail = mg_tls_pending(c);
-  size_t min = avail > MG_MAX_RECV_SIZE ? MG_MAX_RECV_SIZE : avail;
+  size_t min = avail > c->max_recv ? c->max_recv : avail;
   struct mg_iobuf *io = &c->recv;
   if (io->size - io->len < min && !mg_iobuf_resize(io, io->len + min)) {
     mg_error(c, "oom");
@@ -9726,8 +9729,8 @@ static long recv_raw(struct mg_connection *c, void *buf, size_t len) {
 
 static bool ioalloc(struct mg_connection *c, struct mg_iobuf *io) {
   bool res = false;
-  if (io->len >= MG_MAX_RECV_SIZE) {
-    mg_error(c, "MG_MAX_RECV_SIZE");
+  if (io->len >= c->max_recv) {
+    mg_error(c, "max_recv");
   } else if (io->size <= io->len &&
              !mg_iobuf_resize(io, io->size + MG_IO_SIZE)) {
     mg_error(c, "OOM");
@@ -20994,8 +20997,71 @@ static uint32_t be32(const uint8_t *p) {
          (((uint32_t) p[1]) << 16) | (((uint32_t) p[0]) << 24);
 }
 
+#if MG_ENABLE_WS_SIMD && defined(__AVX2__)
+#define MG_WS_AVX2 1
+#endif
+#if MG_ENABLE_WS_SIMD &&                                      \
+    (defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define MG_WS_SSE2 1
+#include <emmintrin.h>
+#elif MG_ENABLE_WS_SIMD && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define MG_WS_NEON 1
+#include <arm_neon.h>
+#endif
+#if MG_WS_AVX2
+#include <immintrin.h>
+#endif
+
+// Copy len bytes from src to dst, XORing them with the 4-byte WebSocket mask.
+// dst may be src. Works 32/16 bytes at a time where the CPU has vectors, then
+// 8-byte words, then single bytes; every block is a multiple of 4 bytes, so
+// the mask lines up without rotating.
+static void mg_ws_xor(uint8_t *dst, const uint8_t *src, size_t len,
+                      const uint8_t *mask) {
+  uint8_t m[4];
+  uint32_t m32;
+  uint64_t m64;
+  size_t i = 0;
+  memcpy(m, mask, sizeof(m));  // mask may sit right before dst
+  memcpy(&m32, m, sizeof(m32));
+  m64 = ((uint64_t) m32 << 32) | m32;
+#if MG_WS_AVX2
+  {
+    __m256i v = _mm256_set1_epi32((int) m32);
+    for (; i + 32 <= len; i += 32) {
+      __m256i x = _mm256_loadu_si256((const __m256i *) (src + i));
+      _mm256_storeu_si256((__m256i *) (dst + i), _mm256_xor_si256(x, v));
+    }
+  }
+#endif
+#if MG_WS_SSE2
+  {
+    __m128i v = _mm_set1_epi32((int) m32);
+    for (; i + 16 <= len; i += 16) {
+      __m128i x = _mm_loadu_si128((const __m128i *) (src + i));
+      _mm_storeu_si128((__m128i *) (dst + i), _mm_xor_si128(x, v));
+    }
+  }
+#elif MG_WS_NEON
+  {
+    uint8x16_t v = vreinterpretq_u8_u32(vdupq_n_u32(m32));
+    for (; i + 16 <= len; i += 16) {
+      vst1q_u8(dst + i, veorq_u8(vld1q_u8(src + i), v));
+    }
+  }
+#endif
+  for (; i + 8 <= len; i += 8) {
+    uint64_t x;
+    memcpy(&x, src + i, sizeof(x));
+    x ^= m64;
+    memcpy(dst + i, &x, sizeof(x));
+  }
+  for (; i < len; i++) dst[i] = (uint8_t) (src[i] ^ m[i & 3]);
+}
+
 static size_t ws_process(uint8_t *buf, size_t len, struct ws_msg *msg) {
-  size_t i, n = 0, mask_len = 0;
+  size_t n = 0, mask_len = 0;
   memset(msg, 0, sizeof(*msg));
   if (len >= 2) {
     n = buf[1] & 0x7f;                // Frame length
@@ -21018,8 +21084,8 @@ static size_t ws_process(uint8_t *buf, size_t len, struct ws_msg *msg) {
   if (msg->data_len > 1024 * 1024 * 1024) return 0;
   if (msg->header_len + msg->data_len > len) return 0;
   if (mask_len > 0) {
-    uint8_t *p = buf + msg->header_len, *m = p - mask_len;
-    for (i = 0; i < msg->data_len; i++) p[i] ^= m[i & 3];
+    uint8_t *p = buf + msg->header_len;
+    mg_ws_xor(p, p, msg->data_len, p - mask_len);
   }
   return msg->header_len + msg->data_len;
 }
@@ -21054,9 +21120,8 @@ static size_t mkhdr(size_t len, int op, bool is_client, uint8_t *buf) {
 
 static void mg_ws_mask(struct mg_connection *c, size_t len) {
   if (c->is_client && c->send.buf != NULL) {
-    size_t i;
-    uint8_t *p = c->send.buf + c->send.len - len, *mask = p - 4;
-    for (i = 0; i < len; i++) p[i] ^= mask[i & 3];
+    uint8_t *p = c->send.buf + c->send.len - len;
+    mg_ws_xor(p, p, len, p - 4);
   }
 }
 
@@ -21065,9 +21130,16 @@ size_t mg_ws_send(struct mg_connection *c, const void *buf, size_t len,
   uint8_t header[14];
   size_t header_len = mkhdr(len, op, c->is_client, header);
   if (!mg_send(c, header, header_len)) return 0;
-  if (!mg_send(c, buf, len)) return header_len;
+  if (c->is_client && len > 0) {
+    // Mask while copying, so the payload is only touched once
+    size_t ofs = c->send.len;
+    if (mg_iobuf_add(&c->send, ofs, NULL, len) == 0) return header_len;
+    mg_ws_xor(c->send.buf + ofs, (const uint8_t *) buf, len,
+              header + header_len - 4);
+  } else if (!mg_send(c, buf, len)) {
+    return header_len;
+  }
   MG_VERBOSE(("WS out: %d [%.*s]", (int) len, (int) len, buf));
-  mg_ws_mask(c, len);
   return header_len + len;
 }
 
@@ -21094,11 +21166,26 @@ static bool mg_ws_client_handshake(struct mg_connection *c) {
   return false;  // Continue event handler
 }
 
+// Append to a message being reassembled. The buffer doubles, up to limit,
+// so a message is copied a constant number of times however many fragments
+// it comes in; mg_iobuf_add would resize it to fit on every call
+static bool ws_append(struct mg_iobuf *io, const void *buf, size_t len,
+                      size_t limit) {
+  if (io->size - io->len < len) {
+    size_t size = io->size * 2;
+    if (size > limit) size = limit;
+    if (size < io->len + len) size = io->len + len;
+    if (!mg_iobuf_resize(io, size)) return false;
+  }
+  if (len > 0) memcpy(io->buf + io->len, buf, len);
+  io->len += len;
+  return true;
+}
+
 static void mg_ws_cb(struct mg_connection *c, int ev, void *ev_data) {
   struct ws_msg msg;
-  size_t ofs = (size_t) c->pfn_data;
+  size_t ofs = 0;  // Handled frames, removed once per read
 
-  // assert(ofs < c->recv.len);
   if (ev == MG_EV_READ) {
     if (c->is_client && !c->is_websocket && mg_ws_client_handshake(c)) return;
 
@@ -21138,27 +21225,47 @@ static void mg_ws_cb(struct mg_connection *c, int ev, void *ev_data) {
           break;
       }
 
-      // Handle fragmented frames: strip header, keep in c->recv
+      ofs += len;  // Removed with the rest after the loop
+
+      // Fragmented message: append payloads to c->wsmsg, after a byte that
+      // keeps the first frame's flags, so reassembly copies each byte once
       if (final == 0 || op == 0) {
-        if (op) ofs++, len--, msg.header_len--;       // First frame
-        mg_iobuf_del(&c->recv, ofs, msg.header_len);  // Strip header
-        len -= msg.header_len;
-        ofs += len;
-        c->pfn_data = (void *) ofs;
-        // MG_INFO(("FRAG %d [%.*s]", (int) ofs, (int) ofs, c->recv.buf));
+        struct mg_iobuf *io = &c->wsmsg;
+        if (op) io->len = 0;  // First frame
+        if (op == 0 && io->len == 0) {
+          mg_error(c, "WS continuation without a first frame");
+          break;
+        } else if (io->len + msg.data_len + (op ? 1 : 0) > c->max_recv) {
+          mg_error(c, "WS message exceeds max_recv");
+          break;
+        } else if ((op && !ws_append(io, &msg.flags, 1, c->max_recv)) ||
+                   !ws_append(io, s, msg.data_len, c->max_recv)) {
+          mg_error(c, "OOM");
+          break;
+        }
       }
-      // Remove non-fragmented frame
-      if (final && op) mg_iobuf_del(&c->recv, ofs, len);
       // Last chunk of the fragmented frame
-      if (final && !op && (ofs > 0)) {
-        m.flags = c->recv.buf[0];
-        m.data = mg_str_n((char *) &c->recv.buf[1], (size_t) (ofs - 1));
+      if (final && !op && c->wsmsg.len > 0) {
+        m.flags = c->wsmsg.buf[0];
+        m.data = mg_str_n((char *) &c->wsmsg.buf[1], c->wsmsg.len - 1);
         mg_call(c, MG_EV_WS_MSG, &m);
-        mg_iobuf_del(&c->recv, 0, ofs);
-        ofs = 0;
-        c->pfn_data = NULL;
+        // Keep the buffer for the next message, unless it only grew that
+        // large for an outsized one
+        if (c->wsmsg.size > MG_MAX_RECV_SIZE) {
+          mg_iobuf_free(&c->wsmsg);
+        } else {
+          c->wsmsg.len = 0;
+        }
       }
     }
+    // One memmove for everything this read completed, not one per frame
+    if (ofs > 0) mg_iobuf_del(&c->recv, 0, ofs);
+    // Likewise give back what an outsized frame left in c->recv, once
+    // little of it is still in use
+    if (ofs > 0 && c->recv.size > MG_MAX_RECV_SIZE &&
+        c->recv.len < c->recv.size / 4) {
+      mg_iobuf_resize(&c->recv, c->recv.len);
+    }
   }
   (void) ev_data;
 }
@@ -968,12 +968,16 @@ struct timeval {
 #define MG_ENABLE_ASSERT 0
 #endif
 
+#ifndef MG_ENABLE_WS_SIMD
+#define MG_ENABLE_WS_SIMD 1  // SSE2/AVX2/NEON WebSocket masking, else by words
+#endif
+
 #ifndef MG_IO_SIZE
 #define MG_IO_SIZE 512  // Granularity of the send/recv IO buffer growth
 #endif
 
 #ifndef MG_MAX_RECV_SIZE
-#define MG_MAX_RECV_SIZE (3UL * 1024UL * 1024UL)  // Maximum recv IO buffer size
+#define MG_MAX_RECV_SIZE (3UL * 1024UL * 1024UL)  // Default c->max_recv
 #endif
 
 #ifndef MG_DATA_SIZE
@@ -1701,6 +1705,8 @@ struct mg_connection {
   struct mg_iobuf send;           // Outgoing data
   struct mg_iobuf prof;           // Profile data enabled by MG_ENABLE_PROFILE
   struct mg_iobuf rtls;           // TLS only. Incoming encrypted data
+  struct mg_iobuf wsmsg;          // WebSocket only. Message being reassembled
+  size_t max_recv;                // Max recv buffer and WebSocket message size
   mg_event_handler_t fn;          // User-specified event handler function
   void *fn_data;                  // User-specified function parameter
   mg_event_handler_t pfn;         // Protocol-specific handler function
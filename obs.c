@@ -1,22 +1,153 @@
 // === Includes ===
 #include <string.h>
+#include "alloc.h"
+#include "config.h"
 #include "obs.h"
+#include "obs_capture.h"
+#include "platform.h"
 
 // === Globals ===
-static const char* obs_ws_url = "ws://127.0.0.1:4455";
-
 typedef struct ObsWsContext {
 	bool identified;
 	bool task_complete;
 	struct mg_connection* con;
 	char* data;
 	u64 data_len;
+	i32 batch_succeeded;
+	bool record_started;	// RecordStateChanged reported OBS_WEBSOCKET_OUTPUT_STARTED
+	u64 record_started_us;	// when that event arrived
 } ObsWsContext;
 
+// A sent request waiting for its response, for the response's latency.
+typedef struct ObsPendingRequest {
+	char id[LOG_REQUEST_ID_SIZE];
+	u64 sent_us;	// 0 for a free entry
+} ObsPendingRequest;
+
 struct mg_mgr obs_mgr;
-ObsWsContext obs_ctx = { false, false, NULL, NULL, 0 };
+ObsWsContext obs_ctx = { false, false, NULL, NULL, 0, 0, false, 0 };
+static ObsPendingRequest obs_pending[OBS_PENDING_REQUESTS];
+static char obs_start_record_payload[256];
+static char obs_pause_record_payload[256];
+static char obs_resume_record_payload[256];
+// Strings pulled out of the message being dispatched, reset after each one.
+static Arena obs_msg_arena;
+// obs_ctx.data for a successful request that returns nothing.
+static char obs_no_data[1];
+static u64 obs_msg_count;
+static u64 obs_heap_count_at_identify;
+
+// === WebSocket send path ===
+// Keep a one-line summary of every frame in the flight recorder.
+static void obs_flight_frame(const char* direction, struct mg_str data) {
+	if (!log_flight_active())
+		return;
+	struct mg_str type = mg_json_get_tok(data, "$.d.requestType");
+	if (type.len < 2)
+		type = mg_json_get_tok(data, "$.d.eventType");
+	char type_name[64] = "";
+	if (type.len >= 2)
+		snprintf(type_name, sizeof(type_name), "%.*s", (i32)type.len - 2, type.buf + 1);
+	log_flight("OBS %s op %ld %s (%llu bytes)", direction, mg_json_get_long(data, "$.op", -1), type_name, (u64)data.len);
+}
+
+// Copy the request ID out of json, without its quotes. Returns false when
+// json has none.
+static bool obs_request_id(struct mg_str json, char* id, u64 id_size) {
+	struct mg_str tok = mg_json_get_tok(json, "$.d.requestId");
+	if (tok.len < 2)
+		return false;
+	snprintf(id, id_size, "%.*s", (i32)tok.len - 2, tok.buf + 1);
+	return true;
+}
+
+// Remember when a request went out. A full table drops its oldest entry.
+static void obs_pending_add(const char* id, u64 sent_us) {
+	ObsPendingRequest* slot = &obs_pending[0];
+	for (i32 i = 0; i < OBS_PENDING_REQUESTS; ++i) {
+		if (obs_pending[i].sent_us < slot->sent_us)
+			slot = &obs_pending[i];
+		if (!slot->sent_us)
+			break;
+	}
+	strcpy_s(slot->id, sizeof(slot->id), id);
+	slot->sent_us = sent_us;
+}
+
+// Forget the request sent with this ID and return when it was sent, or 0 if
+// none is waiting.
+static u64 obs_pending_take(const char* id) {
+	for (i32 i = 0; i < OBS_PENDING_REQUESTS; ++i) {
+		ObsPendingRequest* p = &obs_pending[i];
+		if (p->sent_us && strcmp(p->id, id) == 0) {
+			u64 sent_us = p->sent_us;
+			p->sent_us = 0;
+			return sent_us;
+		}
+	}
+	return 0;
+}
+
+// Request IDs are "<session>-<sequence>", eight hex digits each: the session
+// part is random per connection, so lines from pooled sessions sharing one log
+// stay apart. The fixed width lets a prebuilt frame take a new ID in place.
+#define OBS_REQUEST_ID_LEN 17
+static u32 obs_request_session;
+static u32 obs_request_seq;
+
+static void obs_next_request_id(char* id, u64 id_size) {
+	snprintf(id, id_size, "%08x-%08x", obs_request_session, ++obs_request_seq);
+}
+
+// Give a prebuilt frame a fresh request ID, written over the previous one.
+static void obs_restamp_request_id(char* payload) {
+	static const char key[] = "\"requestId\":\"";
+	char* id = strstr(payload, key);
+	if (!id)
+		return;
+	char fresh[OBS_REQUEST_ID_LEN + 1];
+	obs_next_request_id(fresh, sizeof(fresh));
+	memcpy(id + sizeof(key) - 1, fresh, OBS_REQUEST_ID_LEN);
+}
+
+// Every outbound frame goes through here so captures see both directions.
+// A NULL connection means the frame is being replayed, so nothing is sent.
+void obs_ws_send(struct mg_connection* con, const char* payload, u64 len) {
+	obs_capture_frame(OBS_CAPTURE_OUTBOUND, WEBSOCKET_OP_TEXT, payload, len);
+	obs_flight_frame("sent", mg_str_n(payload, len));
+	if (con) {
+		char id[LOG_REQUEST_ID_SIZE];
+		if (obs_request_id(mg_str_n(payload, len), id, sizeof(id)))
+			obs_pending_add(id, platform_monotonic_us());
+		mg_ws_send(con, payload, len, WEBSOCKET_OP_TEXT);
+	}
+}
+
+// Tag this thread's log lines with the request ID found in json and the time
+// since that request was sent, which also stops waiting for it. Returns false
+// when json has no request ID.
+static bool obs_log_request(struct mg_str json) {
+	char request_id[LOG_REQUEST_ID_SIZE];
+	if (!obs_request_id(json, request_id, sizeof(request_id)))
+		return false;
+	u64 sent_us = obs_pending_take(request_id);
+	i64 latency_us = sent_us ? (i64)(platform_monotonic_us() - sent_us) : -1;
+	log_set_request(request_id, latency_us);
+	return true;
+}
 
 // === WebSocket message handlers ===
+// mg_json_get_str into the message arena: valid until the dispatch ends.
+static char* obs_json_str(struct mg_str json, const char* path) {
+	struct mg_str tok = mg_json_get_tok(json, path);
+	if (tok.len < 2 || tok.buf[0] != '"')
+		return NULL;
+	char* s = arena_alloc(&obs_msg_arena, tok.len - 1);
+	if (s && !mg_json_unescape(mg_str_n(tok.buf + 1, tok.len - 2), s, tok.len - 1))
+		s = NULL;
+	return s;
+}
+
 // Handle OBS WebSocket "Hello" to negotiate RPC version.
 void handle_hello_op(struct mg_connection* con, struct mg_ws_message* msg) {
 	i32 op = mg_json_get_long(msg->data, "$.op", -1);
@@ -29,7 +160,7 @@ void handle_hello_op(struct mg_connection* con, struct mg_ws_message* msg) {
 				mg_print_esc, 0, "op", 1,
 				mg_print_esc, 0, "d",
 				mg_print_esc, 0, "rpcVersion", ver);
-	mg_ws_send(con, payload, strlen(payload), WEBSOCKET_OP_TEXT);
+	obs_ws_send(con, payload, strlen(payload));
 }
 
 // Mark the connection as identified after OBS accepts the handshake.
@@ -41,6 +172,8 @@ void handle_identified_op(struct mg_connection* con, struct mg_ws_message* msg)
 
 	// Mark connection as established
 	obs_ctx.identified = true;
+	obs_heap_count_at_identify = alloc_heap_count();
+	obs_msg_count = 0;
 }
 
 // Build a slash-delimited scene list string to allow substring checks.
@@ -52,37 +185,40 @@ void handle_scene_list_response(struct mg_connection* con, struct mg_ws_message*
 		return;
 
 	// Make sure it's expected response type
-	char* req_type = mg_json_get_str(msg->data, "$.d.requestType");
-	if (!req_type)
-		return;
-	i32 flag = strcmp("GetSceneList", req_type);
-	free(req_type);
-	if (flag != 0)
+	char* req_type = obs_json_str(msg->data, "$.d.requestType");
+	if (!req_type || strcmp("GetSceneList", req_type) != 0)
 		return;
 
+	// Walk the scenes array once per pass; indexing it per scene is quadratic.
+	struct mg_str scenes = mg_json_get_tok(msg->data, "$.d.responseData.scenes");
+	struct mg_str scene;
+	u64 ofs = 0;
 	u64 total_len = 2;
-	for (int i = 0; ; ++i) {
-		char path[64];
-		mg_snprintf(path, sizeof(path), "$.d.responseData.scenes[%d].sceneName", i);
-		char* s = mg_json_get_str(msg->data, path);
-		if (!s) break;
+	while ((ofs = mg_json_next(scenes, ofs, NULL, &scene)) > 0) {
+		char* s = obs_json_str(scene, "$.sceneName");
+		if (!s) continue;
 		total_len += strlen(s) + 1;
-		free(s);
 	}
 
-	obs_ctx.data = (char*)malloc(total_len);
+	obs_ctx.data = mg_calloc(1, total_len);
+	if (!obs_ctx.data) {
+		log_error("could not allocate a scene list of %llu bytes", total_len);
+		obs_ctx.task_complete = true;
+		return;
+	}
 
 	obs_ctx.data[0] = '/';
 	obs_ctx.data[1] = '\0';
 
-	for (int i = 0; ; ++i) {
-		char path[64];
-		mg_snprintf(path, sizeof(path), "$.d.responseData.scenes[%d].sceneName", i);
-		char* s = mg_json_get_str(msg->data, path);
-		if (!s) break;
-		strcat_s(obs_ctx.data, total_len, s);
-		strcat_s(obs_ctx.data, total_len, "/");
-		free(s);
+	u64 len = 1;
+	while ((ofs = mg_json_next(scenes, ofs, NULL, &scene)) > 0) {
+		char* s = obs_json_str(scene, "$.sceneName");
+		if (!s) continue;
+		u64 n = strlen(s);
+		memcpy(obs_ctx.data + len, s, n);
+		len += n;
+		obs_ctx.data[len++] = '/';
+		obs_ctx.data[len] = '\0';
 	}
 
 	log_debug("received scene list: %s", obs_ctx.data);
@@ -90,75 +226,173 @@ void handle_scene_list_response(struct mg_connection* con, struct mg_ws_message*
 	obs_ctx.task_complete = true;
 }
 
-// Handle one-shot request responses (create/switch/start/stop).
+// Handle one-shot request responses (create/switch/start/stop/pause/resume).
 void handle_simple_request_response(struct mg_connection* con, struct mg_ws_message* msg) {
 	(void)con;	// supresss unused reference warning
 	i32 op = mg_json_get_long(msg->data, "$.op", -1);
 	if (op != 7)
 		return;
-	char* req_type = mg_json_get_str(msg->data, "$.d.requestType");
+	char* req_type = obs_json_str(msg->data, "$.d.requestType");
 	if (!req_type)
 		return;
 	i32 is_cr = strcmp("CreateScene", req_type);
 	i32 is_sw = strcmp("SetCurrentProgramScene", req_type);
 	i32 is_start = strcmp("StartRecord", req_type);
 	i32 is_stop = strcmp("StopRecord", req_type);
-	if (is_cr != 0 && is_sw != 0 && is_start != 0 && is_stop != 0) {
-		free(req_type);
+	i32 is_pause = strcmp("PauseRecord", req_type);
+	i32 is_resume = strcmp("ResumeRecord", req_type);
+	if (is_cr != 0 && is_sw != 0 && is_start != 0 && is_stop != 0 && is_pause != 0 && is_resume != 0)
 		return;
-	}
 
-	bool req_status = mg_json_get_bool(msg->data, "$.d.requestStatus.result", false);
-	char* comment = mg_json_get_str(msg->data, "$.d.requestStatus.comment");
+	// The return only says the field exists; its value goes through the pointer.
+	bool ok = false;
+	bool req_status = mg_json_get_bool(msg->data, "$.d.requestStatus.result", &ok) && ok;
+	char* comment = obs_json_str(msg->data, "$.d.requestStatus.comment");
 	if (req_status) {
-		obs_ctx.data = malloc(1);
-		obs_ctx.data_len = 1;
+		// StopRecord reports where the file went; other requests carry no data.
+		// The path outlives the dispatch, so it is not in the message arena.
+		char* output_path = is_stop == 0 ? mg_json_get_str(msg->data, "$.d.responseData.outputPath") : NULL;
+		if (output_path) {
+			obs_ctx.data = output_path;
+			obs_ctx.data_len = strlen(output_path);
+		} else {
+			obs_ctx.data = obs_no_data;
+			obs_ctx.data_len = 0;
+		}
 	} else {
-		if (comment) {
-			log_error("%s request failed: %s", req_type, comment);
+		log_error("%s request failed: %s", req_type, comment ? comment : "no comment");
+	}
+	obs_ctx.task_complete = true;
+}
+
+// Count the successful requests of a RequestBatchResponse (op = 9).
+void handle_batch_response(struct mg_connection* con, struct mg_ws_message* msg) {
+	(void)con;	// supresss unused reference warning
+	i32 op = mg_json_get_long(msg->data, "$.op", -1);
+	if (op != 9)
+		return;
+
+	// Walk the results array once instead of re-parsing from the top per index.
+	struct mg_str results = mg_json_get_tok(msg->data, "$.d.results");
+	struct mg_str result;
+	u64 ofs = 0;
+	i32 succeeded = 0;
+	while ((ofs = mg_json_next(results, ofs, NULL, &result)) > 0) {
+		bool ok = false;
+		if (mg_json_get_bool(result, "$.requestStatus.result", &ok) && ok) {
+			succeeded++;
+			continue;
 		}
+		char* req_type = obs_json_str(result, "$.requestType");
+		char* comment = obs_json_str(result, "$.requestStatus.comment");
+		log_warn("%s request in batch failed: %s", req_type ? req_type : "?", comment ? comment : "no comment");
 	}
-	free(req_type);
-	free(comment);
+	obs_ctx.batch_succeeded = succeeded;
 	obs_ctx.task_complete = true;
 }
 
+// Note when the recording output actually starts (Event, op = 5). The
+// StartRecord response only says OBS accepted the request.
+void handle_record_state_event(struct mg_connection* con, struct mg_ws_message* msg) {
+	(void)con;	// supresss unused reference warning
+	i32 op = mg_json_get_long(msg->data, "$.op", -1);
+	if (op != 5)
+		return;
+	char* event_type = obs_json_str(msg->data, "$.d.eventType");
+	if (!event_type || strcmp(event_type, "RecordStateChanged") != 0)
+		return;
+	char* state = obs_json_str(msg->data, "$.d.eventData.outputState");
+	if (!state || strcmp(state, "OBS_WEBSOCKET_OUTPUT_STARTED") != 0)
+		return;
+	obs_ctx.record_started_us = platform_monotonic_us();
+	obs_ctx.record_started = true;
+}
+
 // Dispatch OBS WebSocket messages to the relevant handlers.
 void obs_ws_event_handler(struct mg_connection* con, i32 ev, void* ev_data) {
 	if (ev == MG_EV_WS_MSG) {
+		struct mg_ws_message* msg = ev_data;
+		if (con)
+			obs_capture_frame(OBS_CAPTURE_INBOUND, msg->flags, msg->data.buf, msg->data.len);
+		obs_flight_frame("received", msg->data);
+		// Responses (op 7 and 9) tag what their handlers log with the request.
+		bool tagged = obs_log_request(msg->data);
+		if (tagged)
+			log_debug("OBS response op %ld", mg_json_get_long(msg->data, "$.op", -1));
 		handle_hello_op(con, ev_data);
 		handle_identified_op(con, ev_data);
 		handle_scene_list_response(con, ev_data);
 		handle_simple_request_response(con, ev_data);
+		handle_batch_response(con, ev_data);
+		handle_record_state_event(con, ev_data);
+		if (tagged)
+			log_set_request(NULL, -1);
+		arena_reset(&obs_msg_arena);
+		obs_msg_count++;
+	} else if (ev == MG_EV_CLOSE && con && con == obs_ctx.con) {
+		// The manager is also the session event loop, so OBS can go away mid-session.
+		log_warn("OBS websocket connection closed");
+		obs_ctx.identified = false;
+		obs_ctx.con = NULL;
 	}
 }
 
 // Poll in fixed slices until the flag equals the expected value.
-// Uses OBS_CONNECT_TIMEOUT_MS as the total time budget (unchanged).
+// Uses OBS_CONNECT_TIMEOUT_MS as the total time budget (unchanged). The budget
+// is measured in time, since unrelated sockets and process exits registered
+// on the manager can end a slice early.
 void obs_poll_while_flag_equals(bool* flag, bool expected_value) {
-	i32 max_iters = (OBS_CONNECT_TIMEOUT_MS + 99) / 100;
-	for (i32 i = 0; i < max_iters && *flag != expected_value; ++i) {
+	u64 deadline = platform_monotonic_us() + (u64)OBS_CONNECT_TIMEOUT_MS * 1000;
+	while (*flag != expected_value && platform_monotonic_us() < deadline) {
 		mg_mgr_poll(&obs_mgr, 100);
 	}
 }
 
 // === Connection lifecycle ===
+// Format an argument-less request into a buffer.
+void obs_build_simple_request(char* payload, u64 payload_size, const char* request_type) {
+	char request_id[OBS_REQUEST_ID_LEN + 1];
+	obs_next_request_id(request_id, sizeof(request_id));
+	mg_snprintf(payload, payload_size, "{%m:6,%m:{%m:%m,%m:%m,%m:{}}}",
+				mg_print_esc, 0, "op",
+				mg_print_esc, 0, "d",
+				mg_print_esc, 0, "requestType", mg_print_esc, 0, request_type,
+				mg_print_esc, 0, "requestId", mg_print_esc, 0, request_id,
+				mg_print_esc, 0, "requestData");
+}
+
+// Format argument-less requests once so sending them later is just a write.
+void obs_prebuild_requests(void) {
+	obs_build_simple_request(obs_start_record_payload, sizeof(obs_start_record_payload), "StartRecord");
+	obs_build_simple_request(obs_pause_record_payload, sizeof(obs_pause_record_payload), "PauseRecord");
+	obs_build_simple_request(obs_resume_record_payload, sizeof(obs_resume_record_payload), "ResumeRecord");
+}
+
 // Open the OBS WebSocket connection and wait until identified.
-i32 obs_connect(void) {
+i32 obs_connect(const char* url) {
 	mg_log_set(MG_LL_ERROR);
 	mg_mgr_init(&obs_mgr);
+	const char* capture_path = config_get_str("obs_capture_path", NULL);
+	if (capture_path && *capture_path)
+		obs_capture_open(capture_path);
 	obs_ctx.identified = false;
 	obs_ctx.task_complete = false;
-	struct mg_connection* con = mg_ws_connect(&obs_mgr, obs_ws_url, obs_ws_event_handler, NULL, NULL);
+	memset(obs_pending, 0, sizeof(obs_pending));
+	mg_random(&obs_request_session, sizeof(obs_request_session));
+	obs_request_seq = 0;
+	obs_prebuild_requests();
+	struct mg_connection* con = mg_ws_connect(&obs_mgr, url, obs_ws_event_handler, NULL, NULL);
 	if (!con) {
 		log_fatal("could not create OBS websocket connection");
 		return 1;
 	}
 	obs_ctx.con = con;
+	i64 max_message = config_get_int("obs_max_message", OBS_MAX_MESSAGE_SIZE);
+	con->max_recv = max_message > 0 ? (u64)max_message : OBS_MAX_MESSAGE_SIZE;
 
 	obs_poll_while_flag_equals(&obs_ctx.identified, true);
 	if (!obs_ctx.identified) {
-		log_fatal("OBS websocket connection timed out after %d ms", OBS_CONNECT_TIMEOUT_MS);
+		log_fatal("OBS websocket connection to %s timed out after %d ms", url, OBS_CONNECT_TIMEOUT_MS);
 		obs_disconnect();
 		obs_ctx.con = NULL;
 		return 1;
@@ -169,17 +403,20 @@ i32 obs_connect(void) {
 }
 
 // Send a request and block until the response handler marks completion.
-i32 obs_send_request(char* payload) {
+i32 obs_send_request(const char* payload) {
 	if (!obs_ctx.identified) {
 		log_fatal("OBS websocket connection is not identified");
 		return 1;
 	}
 	obs_ctx.task_complete = false;
 
-	mg_ws_send(obs_ctx.con, payload, strlen(payload), WEBSOCKET_OP_TEXT);
+	obs_ws_send(obs_ctx.con, payload, strlen(payload));
 	obs_poll_while_flag_equals(&obs_ctx.task_complete, true);
 	if (!obs_ctx.task_complete) {
+		bool tagged = obs_log_request(mg_str(payload));
 		log_error("OBS request timed out after %d ms", OBS_CONNECT_TIMEOUT_MS);
+		if (tagged)
+			log_set_request(NULL, -1);
 		return 1;
 	}
 
@@ -188,41 +425,64 @@ i32 obs_send_request(char* payload) {
 
 // Free any response payload stored in the context.
 void obs_reset_response(void) {
-	if (obs_ctx.data)
-		free(obs_ctx.data);
+	if (obs_ctx.data && obs_ctx.data != obs_no_data)
+		mg_free(obs_ctx.data);
 	obs_ctx.data = NULL;
 	obs_ctx.data_len = 0;
 }
 
+// Run one recorded inbound frame through the handlers, as the replay driver does.
+void obs_dispatch_recorded_frame(struct mg_ws_message* msg) {
+	obs_ws_event_handler(NULL, MG_EV_WS_MSG, msg);
+	obs_reset_response();
+}
+
 // === OBS request helpers ===
-i32 obs_scene_exists(const char* scene_name, bool* exists) {
+i32 obs_get_scene_list(char** scenes) {
 	char payload[1024];
+	char request_id[OBS_REQUEST_ID_LEN + 1];
+	obs_next_request_id(request_id, sizeof(request_id));
 	mg_snprintf(payload, sizeof(payload), "{%m:6,%m:{%m:%m,%m:%m,%m:{}}}",
 				mg_print_esc, 0, "op",
 				mg_print_esc, 0, "d",
 				mg_print_esc, 0, "requestType", mg_print_esc, 0, "GetSceneList",
-				mg_print_esc, 0, "requestId", mg_print_esc, 0, "f819dcf0-89cc-11eb-8f0e-382c4ac93b9c",
+				mg_print_esc, 0, "requestId", mg_print_esc, 0, request_id,
 				mg_print_esc, 0, "requestData");
 
 	i32 err = obs_send_request(payload);
-	
+	if (!err && !obs_ctx.data)
+		err = 1;
 	if (!err) {
-		char pattern[128];
-		sprintf_s(pattern, sizeof(pattern), "/%s/", scene_name);
-		*exists = strstr(obs_ctx.data, pattern);
+		// Hand the list over instead of copying it.
+		*scenes = obs_ctx.data;
+		obs_ctx.data = NULL;
 	}
 
 	obs_reset_response();
 	return err;
 }
 
+i32 obs_scene_exists(const char* scene_name, bool* exists) {
+	char* scenes;
+	i32 err = obs_get_scene_list(&scenes);
+	if (!err) {
+		char pattern[128];
+		sprintf_s(pattern, sizeof(pattern), "/%s/", scene_name);
+		*exists = strstr(scenes, pattern);
+		mg_free(scenes);
+	}
+	return err;
+}
+
 i32 obs_create_scene(const char* scene_name) {
 	char payload[1024];
+	char request_id[OBS_REQUEST_ID_LEN + 1];
+	obs_next_request_id(request_id, sizeof(request_id));
 	mg_snprintf(payload, sizeof(payload), "{%m:6,%m:{%m:%m,%m:%m,%m:{%m:%m}}}",
 				mg_print_esc, 0, "op",
 				mg_print_esc, 0, "d",
 				mg_print_esc, 0, "requestType", mg_print_esc, 0, "CreateScene",
-				mg_print_esc, 0, "requestId", mg_print_esc, 0, "f819dcf0-89cc-11eb-8f0e-382c4ac93b9c",
+				mg_print_esc, 0, "requestId", mg_print_esc, 0, request_id,
 				mg_print_esc, 0, "requestData",
 				mg_print_esc, 0, "sceneName", mg_print_esc, 0, scene_name);
 	i32 err = obs_send_request(payload);
@@ -230,13 +490,54 @@ i32 obs_create_scene(const char* scene_name) {
 	return err;
 }
 
+// One RequestBatch frame carries every CreateScene, so OBS answers once for the
+// whole chunk. haltOnFailure is off so a name that already exists does not
+// stop the rest.
+i32 obs_create_scenes(const char* const* scene_names, i32 count, i32* created) {
+	*created = 0;
+	if (count <= 0)
+		return 0;
+
+	struct mg_iobuf payload = { NULL, 0, 0, 4096 };
+	char request_id[OBS_REQUEST_ID_LEN + 1];
+	obs_next_request_id(request_id, sizeof(request_id));
+	mg_xprintf(mg_pfn_iobuf, &payload, "{%m:8,%m:{%m:%m,%m:false,%m:[",
+			   mg_print_esc, 0, "op",
+			   mg_print_esc, 0, "d",
+			   mg_print_esc, 0, "requestId", mg_print_esc, 0, request_id,
+			   mg_print_esc, 0, "haltOnFailure",
+			   mg_print_esc, 0, "requests");
+	for (i32 i = 0; i < count; ++i) {
+		mg_xprintf(mg_pfn_iobuf, &payload, "%s{%m:%m,%m:{%m:%m}}", i ? "," : "",
+				   mg_print_esc, 0, "requestType", mg_print_esc, 0, "CreateScene",
+				   mg_print_esc, 0, "requestData",
+				   mg_print_esc, 0, "sceneName", mg_print_esc, 0, scene_names[i]);
+	}
+	mg_xprintf(mg_pfn_iobuf, &payload, "]}}");
+	mg_iobuf_add(&payload, payload.len, "", 1);
+	if (payload.buf == NULL) {
+		log_error("could not allocate a batch of %d scenes", count);
+		return 1;
+	}
+
+	obs_ctx.batch_succeeded = 0;
+	i32 err = obs_send_request((const char*)payload.buf);
+	if (!err)
+		*created = obs_ctx.batch_succeeded;
+	mg_iobuf_free(&payload);
+	obs_reset_response();
+	return err;
+}
+
 i32 obs_set_current_scene(const char* scene_name) {
 	char payload[1024];
+	char request_id[OBS_REQUEST_ID_LEN + 1];
+	obs_next_request_id(request_id, sizeof(request_id));
 	mg_snprintf(payload, sizeof(payload), "{%m:6,%m:{%m:%m,%m:%m,%m:{%m:%m}}}",
 				mg_print_esc, 0, "op",
 				mg_print_esc, 0, "d",
 				mg_print_esc, 0, "requestType", mg_print_esc, 0, "SetCurrentProgramScene",
-				mg_print_esc, 0, "requestId", mg_print_esc, 0, "f819dcf0-89cc-11eb-8f0e-382c4ac93b9c",
+				mg_print_esc, 0, "requestId", mg_print_esc, 0, request_id,
 				mg_print_esc, 0, "requestData",
 				mg_print_esc, 0, "sceneName", mg_print_esc, 0, scene_name);
 	i32 err = obs_send_request(payload);
@@ -244,33 +545,82 @@ i32 obs_set_current_scene(const char* scene_name) {
 	return err;
 }
 
-i32 obs_start_recording(void) {
-	char payload[1024];
-	mg_snprintf(payload, sizeof(payload), "{%m:6,%m:{%m:%m,%m:%m,%m:{}}}",
-				mg_print_esc, 0, "op",
-				mg_print_esc, 0, "d",
-				mg_print_esc, 0, "requestType", mg_print_esc, 0, "StartRecord",
-				mg_print_esc, 0, "requestId", mg_print_esc, 0, "f819dcf0-89cc-11eb-8f0e-382c4ac93b9c",
-				mg_print_esc, 0, "requestData");
-	i32 err = obs_send_request(payload);
+// StartRecord carries no arguments, so its frame is formatted once at connect
+// time and a deferred start costs a single send.
+i32 obs_start_recording(u64* started_us) {
+	obs_ctx.record_started = false;
+	obs_restamp_request_id(obs_start_record_payload);
+	i32 err = obs_send_request(obs_start_record_payload);
+	if (!err && !obs_ctx.data)
+		err = 1;
 	obs_reset_response();
-	return err;
+	if (err)
+		return err;
+
+	// The output starts after the response; wait for OBS to say so.
+	obs_poll_while_flag_equals(&obs_ctx.record_started, true);
+	if (obs_ctx.record_started) {
+		*started_us = obs_ctx.record_started_us;
+	} else {
+		log_warn("OBS did not report the recording output as started; timing from the StartRecord response");
+		*started_us = platform_monotonic_us();
+	}
+	return 0;
 }
 
-i32 obs_stop_recording(void) {
+i32 obs_stop_recording(char* output_path, u64 output_path_size) {
 	char payload[1024];
+	char request_id[OBS_REQUEST_ID_LEN + 1];
+	obs_next_request_id(request_id, sizeof(request_id));
 	mg_snprintf(payload, sizeof(payload), "{%m:6,%m:{%m:%m,%m:%m,%m:{}}}",
 				mg_print_esc, 0, "op",
 				mg_print_esc, 0, "d",
 				mg_print_esc, 0, "requestType", mg_print_esc, 0, "StopRecord",
-				mg_print_esc, 0, "requestId", mg_print_esc, 0, "f819dcf0-89cc-11eb-8f0e-382c4ac93b9c",
+				mg_print_esc, 0, "requestId", mg_print_esc, 0, request_id,
 				mg_print_esc, 0, "requestData");
 	i32 err = obs_send_request(payload);
+	if (output_path_size > 0)
+		output_path[0] = '\0';
+	if (!err && obs_ctx.data)
+		snprintf(output_path, output_path_size, "%s", obs_ctx.data);
+	obs_reset_response();
+	return err;
+}
+
+// A rejected request (not recording, already paused) leaves no response data,
+// and fails here so the caller's pause state keeps following OBS.
+i32 obs_pause_recording(void) {
+	obs_restamp_request_id(obs_pause_record_payload);
+	i32 err = obs_send_request(obs_pause_record_payload);
+	if (!err && !obs_ctx.data)
+		err = 1;
+	obs_reset_response();
+	return err;
+}
+
+i32 obs_resume_recording(void) {
+	obs_restamp_request_id(obs_resume_record_payload);
+	i32 err = obs_send_request(obs_resume_record_payload);
+	if (!err && !obs_ctx.data)
+		err = 1;
 	obs_reset_response();
 	return err;
 }
 
+// The manager behind the OBS connection, for callers that wait on other events too.
+struct mg_mgr* obs_event_loop(void) {
+	return &obs_mgr;
+}
+
 // === Shutdown ===
 void obs_disconnect(void) {
+	if (obs_msg_count > 0)
+		log_debug("OBS handled %llu messages with %llu heap allocations after identifying",
+				  obs_msg_count, alloc_heap_count() - obs_heap_count_at_identify);
+	obs_msg_count = 0;
+	arena_free(&obs_msg_arena);
+	obs_ctx.identified = false;
+	obs_ctx.con = NULL;
 	mg_mgr_free(&obs_mgr);
+	obs_capture_close();
 }
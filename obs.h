@@ -15,18 +15,52 @@
 #define OBS_REQUEST_TIMEOUT_MS 5000
 #endif
 
-i32 obs_connect(void);
+// Largest message taken from OBS, as one frame or reassembled from fragments
+// (screenshots, big input lists). The obs_max_message setting overrides it.
+#ifndef OBS_MAX_MESSAGE_SIZE
+#define OBS_MAX_MESSAGE_SIZE (64 * 1024 * 1024)
+#endif
+
+// Requests whose send time is kept for the response's latency. Past this many
+// unanswered ones, the oldest is forgotten and its response logs no latency.
+#ifndef OBS_PENDING_REQUESTS
+#define OBS_PENDING_REQUESTS 16
+#endif
+
+i32 obs_connect(const char* url);
 
 void obs_disconnect(void);
 
+struct mg_mgr* obs_event_loop(void);
+
 // === Scene operations ===
+// scenes receives "/name/name/.../" for substring checks; the caller frees it
+// with mg_free.
+i32 obs_get_scene_list(char** scenes);
+
 i32 obs_scene_exists(const char* scene_name, bool *exists);
 
 i32 obs_create_scene(const char* scene_name);
 
+// Create count scenes with one batched request; created receives how many succeeded.
+i32 obs_create_scenes(const char* const* scene_names, i32 count, i32* created);
+
 i32 obs_set_current_scene(const char* scene_name);
 
 // === Recording operations ===
-i32 obs_start_recording(void);
+// started_us receives the monotonic time the recording output started, taken
+// when OBS reports it (RecordStateChanged), or the StartRecord response time
+// if that event does not arrive in time.
+i32 obs_start_recording(u64* started_us);
+
+// output_path receives the recording file reported by OBS, or "" if unknown.
+i32 obs_stop_recording(char* output_path, u64 output_path_size);
+
+i32 obs_pause_recording(void);
+
+i32 obs_resume_recording(void);
+
+// === Event dispatch ===
+void obs_ws_event_handler(struct mg_connection* con, i32 ev, void* ev_data);
 
-i32 obs_stop_recording(void);
+void obs_dispatch_recorded_frame(struct mg_ws_message* msg);
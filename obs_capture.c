@@ -0,0 +1,202 @@
+// === Includes ===
+#include "obs_capture.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "log.h"
+#include "obs.h"
+#include "platform.h"
+
+// === Globals ===
+typedef struct ObsCaptureContext {
+	FILE* fp;
+	u64 last_us;
+	u64 frames;
+	char buffer[64 * 1024];
+} ObsCaptureContext;
+
+static ObsCaptureContext capture_ctx = { NULL, 0, 0, { 0 } };
+
+// === Varint helpers ===
+static void obs_capture_write_varint(FILE* fp, u64 value) {
+	u8 buf[10];
+	i32 n = 0;
+	do {
+		u8 byte = value & 0x7f;
+		value >>= 7;
+		buf[n++] = byte | (value ? 0x80 : 0);
+	} while (value);
+	fwrite(buf, 1, n, fp);
+}
+
+// Returns false when the varint runs past the end of the buffer.
+static bool obs_capture_read_varint(const u8** cursor, const u8* end, u64* value) {
+	u64 result = 0;
+	for (i32 shift = 0; shift < 64 && *cursor < end; shift += 7) {
+		u8 byte = *(*cursor)++;
+		result |= (u64)(byte & 0x7f) << shift;
+		if (!(byte & 0x80)) {
+			*value = result;
+			return true;
+		}
+	}
+	return false;
+}
+
+// === Capture ===
+i32 obs_capture_open(const char* path) {
+	obs_capture_close();
+
+	FILE* fp = fopen(path, "wb");
+	if (!fp) {
+		log_error("could not open OBS capture file %s", path);
+		return 1;
+	}
+	setvbuf(fp, capture_ctx.buffer, _IOFBF, sizeof(capture_ctx.buffer));
+
+	u8 header[8] = { 0 };
+	memcpy(header, OBS_CAPTURE_MAGIC, 6);
+	header[6] = OBS_CAPTURE_VERSION;
+	fwrite(header, 1, sizeof(header), fp);
+
+	capture_ctx.fp = fp;
+	capture_ctx.last_us = platform_monotonic_us();
+	capture_ctx.frames = 0;
+	log_info("capturing OBS websocket frames to %s", path);
+	return 0;
+}
+
+void obs_capture_close(void) {
+	if (!capture_ctx.fp)
+		return;
+	fclose(capture_ctx.fp);
+	capture_ctx.fp = NULL;
+	log_info("OBS capture closed after %llu frames", capture_ctx.frames);
+}
+
+bool obs_capture_is_open(void) {
+	return capture_ctx.fp != NULL;
+}
+
+void obs_capture_frame(ObsCaptureDirection direction, u8 ws_flags, const char* data, u64 len) {
+	if (!capture_ctx.fp)
+		return;
+
+	u64 now = platform_monotonic_us();
+	obs_capture_write_varint(capture_ctx.fp, now - capture_ctx.last_us);
+	capture_ctx.last_us = now;
+
+	u8 tag = (u8)((direction == OBS_CAPTURE_OUTBOUND ? 0x80 : 0) | (ws_flags & 0x0f));
+	fputc(tag, capture_ctx.fp);
+	obs_capture_write_varint(capture_ctx.fp, len);
+	fwrite(data, 1, len, capture_ctx.fp);
+	capture_ctx.frames++;
+}
+
+// === Replay ===
+// Load the whole capture up front so file I/O never lands inside the measured region.
+static i32 obs_replay_read_file(const char* path, u8** output, u64* output_len) {
+	FILE* fp = fopen(path, "rb");
+	if (!fp) {
+		log_error("could not open OBS capture %s", path);
+		return 1;
+	}
+
+	u64 cap = 64 * 1024, len = 0;
+	u8* buf = malloc(cap);
+	if (!buf) {
+		fclose(fp);
+		log_error("out of memory reading %s", path);
+		return 1;
+	}
+	for (;;) {
+		if (len == cap) {
+			cap *= 2;
+			u8* grown = realloc(buf, cap);
+			if (!grown) {
+				free(buf);
+				fclose(fp);
+				log_error("out of memory reading %s", path);
+				return 1;
+			}
+			buf = grown;
+		}
+		u64 n = fread(buf + len, 1, cap - len, fp);
+		if (n == 0)
+			break;
+		len += n;
+	}
+	fclose(fp);
+
+	*output = buf;
+	*output_len = len;
+	return 0;
+}
+
+i32 obs_replay_run(const char* path, bool max_speed) {
+	u8* data = NULL;
+	u64 data_len = 0;
+	if (obs_replay_read_file(path, &data, &data_len))
+		return 1;
+
+	i32 err = 0;
+	if (data_len < 8 || memcmp(data, OBS_CAPTURE_MAGIC, 6) != 0 || data[6] != OBS_CAPTURE_VERSION) {
+		log_error("%s is not an OBS capture (version %d)", path, OBS_CAPTURE_VERSION);
+		err = 1;
+		goto err_free;
+	}
+
+	const u8* cursor = data + 8;
+	const u8* end = data + data_len;
+	u64 recorded_us = 0, inbound = 0, outbound = 0;
+	u64 handler_us = 0, handler_max_us = 0;
+	u64 replay_start = platform_monotonic_us();
+
+	while (cursor < end) {
+		u64 delta_us, len;
+		if (!obs_capture_read_varint(&cursor, end, &delta_us) || cursor >= end) {
+			err = 1;
+			break;
+		}
+		u8 tag = *cursor++;
+		if (!obs_capture_read_varint(&cursor, end, &len) || len > (u64)(end - cursor)) {
+			err = 1;
+			break;
+		}
+		const char* payload = (const char*)cursor;
+		cursor += len;
+		recorded_us += delta_us;
+
+		if (tag & 0x80) {
+			outbound++;
+			continue;
+		}
+
+		if (!max_speed) {
+			u64 elapsed = platform_monotonic_us() - replay_start;
+			if (recorded_us > elapsed)
+				platform_sleep_ms((u32)((recorded_us - elapsed) / 1000));
+		}
+
+		struct mg_ws_message msg = { mg_str_n(payload, (size_t)len), (u8)(0x80 | (tag & 0x0f)) };
+		u64 t0 = platform_monotonic_us();
+		obs_dispatch_recorded_frame(&msg);
+		u64 spent = platform_monotonic_us() - t0;
+		handler_us += spent;
+		if (spent > handler_max_us)
+			handler_max_us = spent;
+		inbound++;
+	}
+
+	if (err)
+		log_error("OBS capture %s is truncated after %llu frames", path, inbound + outbound);
+
+	log_info("replayed %llu inbound frames (%llu outbound skipped) spanning %llu ms",
+			 inbound, outbound, recorded_us / 1000);
+	log_info("handler time: total %llu us, mean %llu us, max %llu us",
+			 handler_us, inbound ? handler_us / inbound : 0, handler_max_us);
+
+err_free:
+	free(data);
+	return err;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+// === Includes ===
+#include "mongoose.h"
+#include "types.h"
+#include <stdbool.h>
+
+// === Capture format ===
+// File header: "SGRCAP" magic, one version byte, one reserved byte.
+// Each record: varint microseconds since the previous record, one tag byte
+// (bit 7 = outbound, low nibble = WebSocket opcode), varint length, payload.
+#define OBS_CAPTURE_MAGIC "SGRCAP"
+#define OBS_CAPTURE_VERSION 1
+
+typedef enum ObsCaptureDirection {
+	OBS_CAPTURE_INBOUND = 0,
+	OBS_CAPTURE_OUTBOUND = 1,
+} ObsCaptureDirection;
+
+// === Capture ===
+i32 obs_capture_open(const char* path);
+
+void obs_capture_close(void);
+
+bool obs_capture_is_open(void);
+
+void obs_capture_frame(ObsCaptureDirection direction, u8 ws_flags, const char* data, u64 len);
+
+// === Replay ===
+// Feed every inbound frame of a capture through the OBS client handlers.
+// With max_speed false, frames are paced by their recorded timestamps.
+i32 obs_replay_run(const char* path, bool max_speed);
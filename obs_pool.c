@@ -0,0 +1,152 @@
+// === Includes ===
+#include "obs_pool.h"
+#include <stdio.h>
+#include <string.h>
+#include "config.h"
+#include "log.h"
+
+// === Pool config ===
+typedef struct ObsPool {
+	i32 count;
+	char urls[OBS_POOL_MAX_INSTANCES][256];
+} ObsPool;
+
+static i32 obs_pool_load(ObsPool* pool) {
+	const char* list = config_get_str("obs_pool", OBS_POOL_DEFAULT_URL);
+	pool->count = 0;
+	while (*list) {
+		while (*list == ' ' || *list == ',')
+			++list;
+		u64 len = strcspn(list, ", ");
+		if (len == 0)
+			break;
+		if (pool->count == OBS_POOL_MAX_INSTANCES) {
+			log_warn("obs_pool lists more than %d instances; ignoring the rest", OBS_POOL_MAX_INSTANCES);
+			break;
+		}
+		snprintf(pool->urls[pool->count++], sizeof(pool->urls[0]), "%.*s", (int)len, list);
+		list += len;
+	}
+	if (pool->count == 0) {
+		log_fatal("obs_pool does not list any OBS instance");
+		return 1;
+	}
+	return 0;
+}
+
+// Lock files are keyed by URL, so sessions with differently ordered pools
+// still agree on which instance is taken.
+static u32 obs_pool_hash(const char* url) {
+	u32 hash = 2166136261u;
+	for (; *url; ++url)
+		hash = (hash ^ (u8)*url) * 16777619u;
+	return hash;
+}
+
+static i32 obs_pool_lock_path(const char* url, char* path, u64 path_size) {
+	char dir[1024];
+	const char* lock_dir = config_get_str("obs_pool_lock_dir", NULL);
+	if (lock_dir && *lock_dir)
+		snprintf(dir, sizeof(dir), "%s", lock_dir);
+	else if (platform_temp_dir(dir, sizeof(dir)))
+		return 1;
+	return snprintf(path, path_size, "%s/smart_grecording-obs-%08x.lock", dir, obs_pool_hash(url)) >= (i32)path_size;
+}
+
+// Without a usable lock directory every instance would look busy forever.
+static i32 obs_pool_check_lock_dir(const ObsPool* pool) {
+	char path[1200];
+	if (obs_pool_lock_path(pool->urls[0], path, sizeof(path))) {
+		log_fatal("no usable directory for OBS pool lock files");
+		return 1;
+	}
+	return 0;
+}
+
+static bool obs_pool_try_lock(const char* url, PlatformFileLock* lock) {
+	char path[1200];
+	if (obs_pool_lock_path(url, path, sizeof(path)))
+		return false;
+	return platform_try_lock_file(path, lock) == 0;
+}
+
+// Probing takes and drops each free lock, so a session racing us may have to
+// retry once; it never loses its turn for long.
+static i32 obs_pool_count_busy(const ObsPool* pool, i32 skip) {
+	i32 busy = 0;
+	for (i32 i = 0; i < pool->count; ++i) {
+		if (i == skip)
+			continue;
+		PlatformFileLock lock;
+		if (obs_pool_try_lock(pool->urls[i], &lock))
+			platform_unlock_file(&lock);
+		else
+			busy++;
+	}
+	return busy;
+}
+
+// === Leases ===
+i32 obs_pool_acquire(ObsPoolLease* lease) {
+	ObsPool pool;
+	if (obs_pool_load(&pool) || obs_pool_check_lock_dir(&pool))
+		return 1;
+
+	u64 wait_limit_us = (u64)config_get_int("obs_pool_wait_ms", 0) * 1000;
+	u64 start = platform_monotonic_us();
+	bool waiting = false;
+	for (;;) {
+		for (i32 i = 0; i < pool.count; ++i) {
+			if (!obs_pool_try_lock(pool.urls[i], &lease->lock))
+				continue;
+			lease->held = true;
+			lease->index = i;
+			lease->size = pool.count;
+			snprintf(lease->url, sizeof(lease->url), "%s", pool.urls[i]);
+			lease->acquired_us = platform_monotonic_us();
+			i32 busy = obs_pool_count_busy(&pool, i) + 1;
+			log_info("leased OBS instance %d of %d (%s) after waiting %llu ms; %d of %d busy",
+					 i + 1, pool.count, lease->url, (lease->acquired_us - start) / 1000, busy, pool.count);
+			return 0;
+		}
+
+		u64 waited_us = platform_monotonic_us() - start;
+		if (wait_limit_us && waited_us >= wait_limit_us) {
+			log_fatal("no OBS instance became free within %llu ms", wait_limit_us / 1000);
+			return 1;
+		}
+		if (!waiting) {
+			log_info("all %d OBS instances are busy; retrying every %d ms", pool.count, OBS_POOL_RETRY_MS);
+			waiting = true;
+		}
+		platform_sleep_ms(OBS_POOL_RETRY_MS);
+	}
+}
+
+void obs_pool_release(ObsPoolLease* lease) {
+	if (!lease->held)
+		return;
+	platform_unlock_file(&lease->lock);
+	lease->held = false;
+	log_info("released OBS instance %d of %d after %llu s", lease->index + 1, lease->size,
+			 (platform_monotonic_us() - lease->acquired_us) / 1000000);
+}
+
+i32 obs_pool_report(void) {
+	ObsPool pool;
+	if (obs_pool_load(&pool) || obs_pool_check_lock_dir(&pool))
+		return 1;
+
+	i32 busy = 0;
+	for (i32 i = 0; i < pool.count; ++i) {
+		PlatformFileLock lock;
+		bool is_free = obs_pool_try_lock(pool.urls[i], &lock);
+		if (is_free)
+			platform_unlock_file(&lock);
+		else
+			busy++;
+		log_info("OBS instance %d (%s): %s", i + 1, pool.urls[i], is_free ? "free" : "busy");
+	}
+	log_info("%d of %d OBS instances busy (%d%%)", busy, pool.count, busy * 100 / pool.count);
+	return 0;
+}
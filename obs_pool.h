@@ -0,0 +1,45 @@
+#pragma once
+
+// === Includes ===
+#include "platform.h"
+#include "types.h"
+#include <stdbool.h>
+
+// === OBS instance pool ===
+// Lets several wrapper processes on one host share a set of OBS instances
+// (e.g. portable installs on different WebSocket ports). The obs_pool config
+// key lists their URLs, comma-separated. Each session leases the first free
+// instance through a lock file in the temp directory and keeps it until exit;
+// when every instance is busy it retries them until one frees up. Waiting
+// sessions are not ordered: whichever retries first after a release gets the
+// instance, so one can be passed over. Leases are per process, so one
+// session's handshake never holds up another's launch.
+#ifndef OBS_POOL_MAX_INSTANCES
+#define OBS_POOL_MAX_INSTANCES 16
+#endif
+
+#ifndef OBS_POOL_DEFAULT_URL
+#define OBS_POOL_DEFAULT_URL "ws://127.0.0.1:4455"
+#endif
+
+// How often a waiting session retries the instances.
+#ifndef OBS_POOL_RETRY_MS
+#define OBS_POOL_RETRY_MS 250
+#endif
+
+typedef struct ObsPoolLease {
+	bool held;
+	i32 index;
+	i32 size;
+	char url[256];
+	PlatformFileLock lock;
+	u64 acquired_us;
+} ObsPoolLease;
+
+// Wait until an instance is free (or obs_pool_wait_ms has passed) and lease it.
+i32 obs_pool_acquire(ObsPoolLease* lease);
+
+void obs_pool_release(ObsPoolLease* lease);
+
+// Log each instance as busy or free, plus overall utilization.
+i32 obs_pool_report(void);
@@ -1,7 +1,10 @@
 #include "path.h"
 #include <stdbool.h>
 #include <stdio.h>
+#include <ctype.h>
 #include "log.h"
+#include "mongoose.h"
+#include "platform.h"
 #include <string.h>
 
 // === Path helpers ===
@@ -10,33 +13,86 @@ bool is_path_separator(char c) {
 	return (c == '\\' || c == '/');
 }
 
-// Extract the Steam "common/<game>" folder name from a full path.
-i32 extract_game_name_from_path(const char* path, char* output, i32 output_size) {
-	const char* common_ptr = strstr(path, "common");
-	if (common_ptr == NULL) {
-		return 1;
+static bool component_equals(const char* start, const char* end, const char* name) {
+	u64 len = strlen(name);
+	if ((u64)(end - start) != len)
+		return false;
+	for (u64 i = 0; i < len; ++i) {
+		if (tolower((u8)start[i]) != name[i])
+			return false;
 	}
+	return true;
+}
 
-	const char* start = common_ptr + 6;
-	if (is_path_separator(*start)) {
-		start++;
+// Locate <game> in ".../steamapps/common/<game>/...". The last "common" right
+// under "steamapps" wins, so parent folders that happen to contain "common"
+// are skipped; any "common" component is the fallback for unusual layouts.
+static bool find_steam_game_component(const char* path, const char** start, const char** end) {
+	const char* prev_start = NULL;
+	const char* prev_end = NULL;
+	const char* weak = NULL;
+	const char* strong = NULL;
+	const char* p = path;
+	while (*p) {
+		while (is_path_separator(*p))
+			p++;
+		const char* comp_start = p;
+		while (*p && !is_path_separator(*p))
+			p++;
+		const char* comp_end = p;
+		if (comp_end == comp_start)
+			break;
+		if (component_equals(comp_start, comp_end, "common") && *p) {
+			if (prev_start && component_equals(prev_start, prev_end, "steamapps"))
+				strong = comp_end + 1;
+			else
+				weak = comp_end + 1;
+		}
+		prev_start = comp_start;
+		prev_end = comp_end;
 	}
 
-	const char* end = start;
-	while (*end != '\0' && !is_path_separator(*end)) {
-		end++;
-	}
+	const char* game = strong ? strong : weak;
+	if (!game)
+		return false;
+	while (is_path_separator(*game))
+		game++;
+	const char* game_end = game;
+	while (*game_end && !is_path_separator(*game_end))
+		game_end++;
+	if (game_end == game)
+		return false;
+	*start = game;
+	*end = game_end;
+	return true;
+}
 
-	u64 len = end - start;
-	if (len <= 0) {
+// Extract the Steam "common/<game>" folder name from a full path.
+i32 extract_game_name_from_path(const char* path, char* output, i32 output_size) {
+	const char* start;
+	const char* end;
+	if (!find_steam_game_component(path, &start, &end)) {
 		return 1;
 	}
 
+	u64 len = end - start;
 	strncpy_s(output, output_size, start, len);
 
 	return 0;
 }
 
+// The "<library>/steamapps/common/<game>" prefix of path.
+i32 extract_steam_install_dir(const char* path, char* output, i32 output_size) {
+	const char* start;
+	const char* end;
+	if (!find_steam_game_component(path, &start, &end) || (u64)(end - path) + 1 > (u64)output_size) {
+		return 1;
+	}
+
+	strncpy_s(output, output_size, path, end - path);
+	return 0;
+}
+
 // Returns 0 on success, non-zero on failure (e.g., output buffer too small).
 i32 extract_parent_folder(const char* path, char* output, i32 output_size) {
 	u64 len = strlen(path);
@@ -57,3 +113,33 @@ err:
 	output[0] = '\0';
 	return 1;
 }
+
+// Copy a path with '/' separators and lowercase letters into output.
+u64 path_normalize(const char* path, char* output, u64 output_size) {
+	u64 len = 0;
+	for (; path[len] != '\0' && len + 1 < output_size; ++len) {
+		char c = path[len];
+		output[len] = is_path_separator(c) ? '/' : (char)tolower((u8)c);
+	}
+	output[len] = '\0';
+	return len;
+}
+
+// Case-insensitive glob on either separator style, so Proton's "Z:\\...\\game.exe"
+// matches the same rule as a native path. '?' matches one character, '*' any
+// run without a separator and '#' any run including separators. A pattern
+// without a separator is matched against the file name only.
+bool path_matches_pattern(const char* path, const char* pattern) {
+	char norm_path[1024], norm_pattern[512];
+	u64 path_len = path_normalize(path, norm_path, sizeof(norm_path));
+	u64 pattern_len = path_normalize(pattern, norm_pattern, sizeof(norm_pattern));
+
+	const char* subject = norm_path;
+	if (!strchr(norm_pattern, '/')) {
+		const char* slash = strrchr(norm_path, '/');
+		if (slash)
+			subject = slash + 1;
+	}
+	u64 subject_len = path_len - (u64)(subject - norm_path);
+	return mg_match(mg_str_n(subject, subject_len), mg_str_n(norm_pattern, pattern_len), NULL);
+}
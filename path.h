@@ -1,6 +1,15 @@
 #pragma once
 #include "types.h"
+#include <stdbool.h>
 
 i32 extract_game_name_from_path(const char* path, char* output, i32 output_size);
 
 i32 extract_parent_folder(const char* path, char* output, i32 output_size);
+
+i32 extract_steam_install_dir(const char* path, char* output, i32 output_size);
+
+// Lowercase with '/' separators; returns the normalized length.
+u64 path_normalize(const char* path, char* output, u64 output_size);
+
+// Match a glob against a process image path (see path.c for the syntax).
+bool path_matches_pattern(const char* path, const char* pattern);
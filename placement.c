@@ -0,0 +1,110 @@
+#include "placement.h"
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "log.h"
+
+// === Parsing ===
+// Accepts comma-separated CPU numbers and ranges below 64, e.g. "0,2-3".
+bool placement_parse_cpu_list(const char* list, u64* mask) {
+	u64 result = 0;
+	const char* p = list;
+	while (*p) {
+		char* end;
+		long first = strtol(p, &end, 10);
+		if (end == p)
+			return false;
+		long last = first;
+		p = end;
+		if (*p == '-') {
+			last = strtol(p + 1, &end, 10);
+			if (end == p + 1)
+				return false;
+			p = end;
+		}
+		if (first < 0 || last < first || last > 63)
+			return false;
+		for (long cpu = first; cpu <= last; ++cpu)
+			result |= (u64)1 << cpu;
+		while (*p == ' ')
+			++p;
+		if (*p == ',')
+			++p;
+		else if (*p != '\0')
+			return false;
+		while (*p == ' ')
+			++p;
+	}
+	*mask = result;
+	return result != 0;
+}
+
+bool placement_parse_priority(const char* name, PlatformPriority* priority) {
+	static const struct {
+		const char* name;
+		PlatformPriority priority;
+	} names[] = {
+		{ "idle", PLATFORM_PRIORITY_IDLE },
+		{ "below_normal", PLATFORM_PRIORITY_BELOW_NORMAL },
+		{ "normal", PLATFORM_PRIORITY_NORMAL },
+		{ "above_normal", PLATFORM_PRIORITY_ABOVE_NORMAL },
+		{ "high", PLATFORM_PRIORITY_HIGH },
+	};
+	for (u64 i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+		if (strcmp(name, names[i].name) == 0) {
+			*priority = names[i].priority;
+			return true;
+		}
+	}
+	return false;
+}
+
+// === Policy ===
+static void placement_load_one(PlatformPlacement* placement, const char* cpus_key, const char* priority_key) {
+	placement->cpu_mask = 0;
+	placement->priority = PLATFORM_PRIORITY_UNCHANGED;
+
+	const char* cpus = config_get_str(cpus_key, NULL);
+	if (cpus && *cpus && !placement_parse_cpu_list(cpus, &placement->cpu_mask))
+		log_warn("config '%s' is not a CPU list: %s", cpus_key, cpus);
+
+	const char* priority = priority_key ? config_get_str(priority_key, NULL) : NULL;
+	if (priority && *priority && !placement_parse_priority(priority, &placement->priority))
+		log_warn("config '%s' is not a priority: %s", priority_key, priority);
+}
+
+static bool placement_is_set(const PlatformPlacement* placement) {
+	return placement->cpu_mask != 0 || placement->priority != PLATFORM_PRIORITY_UNCHANGED;
+}
+
+void placement_load(PlacementPolicy* policy) {
+	placement_load_one(&policy->wrapper, "wrapper_cpus", NULL);
+	placement_load_one(&policy->game, "game_cpus", "game_priority");
+	placement_load_one(&policy->obs, "obs_cpus", "obs_priority");
+	policy->obs_process = config_get_str("obs_process", OBS_EXE_NAME);
+}
+
+const PlatformPlacement* placement_for_game(const PlacementPolicy* policy) {
+	return placement_is_set(&policy->game) ? &policy->game : NULL;
+}
+
+// Only called after the game is spawned, which would otherwise inherit the mask.
+void placement_apply_wrapper(const PlacementPolicy* policy) {
+	if (!placement_is_set(&policy->wrapper))
+		return;
+	if (platform_apply_placement(0, &policy->wrapper) == 0)
+		log_info("pinned wrapper to CPU mask 0x%llx", policy->wrapper.cpu_mask);
+}
+
+void placement_apply_obs(const PlacementPolicy* policy) {
+	if (!placement_is_set(&policy->obs))
+		return;
+	i64 pids[PLACEMENT_MAX_OBS_PROCESSES];
+	i32 count = platform_find_processes(policy->obs_process, pids, PLACEMENT_MAX_OBS_PROCESSES);
+	if (count == 0)
+		log_warn("no process matching '%s' to place", policy->obs_process);
+	for (i32 i = 0; i < count; ++i) {
+		if (platform_apply_placement(pids[i], &policy->obs) == 0)
+			log_info("placed OBS process %lld", pids[i]);
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "platform.h"
+#include "types.h"
+#include <stdbool.h>
+
+// === Placement policy ===
+// Keeps the wrapper, OBS and the game off each other's cores. CPU lists use
+// the "0,2-3" form; priorities are idle, below_normal, normal, above_normal
+// or high. Unset keys leave the OS defaults alone.
+//   wrapper_cpus                  housekeeping core(s) for the wrapper itself
+//   game_cpus, game_priority      applied when the game is spawned or detected
+//   obs_cpus, obs_priority        applied to processes matching obs_process
+//                                 (default: the OBS executable) once recording starts
+#ifndef PLACEMENT_MAX_OBS_PROCESSES
+#define PLACEMENT_MAX_OBS_PROCESSES 8
+#endif
+
+typedef struct PlacementPolicy {
+	PlatformPlacement wrapper;
+	PlatformPlacement game;
+	PlatformPlacement obs;
+	const char* obs_process;
+} PlacementPolicy;
+
+// Read the policy from the config; invalid values are logged and ignored.
+void placement_load(PlacementPolicy* policy);
+
+// NULL when the policy leaves the game alone.
+const PlatformPlacement* placement_for_game(const PlacementPolicy* policy);
+
+void placement_apply_wrapper(const PlacementPolicy* policy);
+
+void placement_apply_obs(const PlacementPolicy* policy);
+
+// === Parsing ===
+bool placement_parse_cpu_list(const char* list, u64* mask);
+
+bool placement_parse_priority(const char* name, PlatformPriority* priority);
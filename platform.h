@@ -0,0 +1,204 @@
+#pragma once
+#include "types.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+// === Platform layer ===
+// Process management and OS helpers. platform_win32.c backs this on Windows,
+// platform_posix.c on Linux; everything else stays OS-agnostic.
+
+#ifdef _WIN32
+#define OBS_EXE_DIR "C:\\Program Files\\obs-studio\\bin\\64bit"
+#define OBS_EXE_NAME "obs64.exe"
+#else
+#define OBS_EXE_DIR "/usr/bin"
+#define OBS_EXE_NAME "obs"
+#endif
+
+// === Bounds-checked string shims ===
+// The MSVC CRT provides these; elsewhere they truncate instead of aborting.
+#ifndef _WIN32
+// Copy n bytes of src to dst + len, truncating to fit dst_size.
+static inline void platform_copy_truncated(char* dst, u64 dst_size, u64 len, const char* src, u64 n) {
+	if (dst_size == 0)
+		return;
+	if (len >= dst_size)
+		len = dst_size - 1;
+	if (n > dst_size - 1 - len)
+		n = dst_size - 1 - len;
+	memcpy(dst + len, src, n);
+	dst[len + n] = '\0';
+}
+
+static inline i32 strcpy_s(char* dst, u64 dst_size, const char* src) {
+	platform_copy_truncated(dst, dst_size, 0, src, strlen(src));
+	return 0;
+}
+
+static inline i32 strcat_s(char* dst, u64 dst_size, const char* src) {
+	platform_copy_truncated(dst, dst_size, strlen(dst), src, strlen(src));
+	return 0;
+}
+
+static inline i32 strncpy_s(char* dst, u64 dst_size, const char* src, u64 count) {
+	u64 n = 0;
+	while (n < count && src[n])
+		n++;
+	platform_copy_truncated(dst, dst_size, 0, src, n);
+	return 0;
+}
+
+#define sprintf_s snprintf
+#endif
+
+// === Processes ===
+#ifndef PLATFORM_MAX_TRACKED_PROCESSES
+#define PLATFORM_MAX_TRACKED_PROCESSES 256
+#endif
+
+typedef struct PlatformProcess {
+	i64 pid;
+#ifdef _WIN32
+	void* handle;	// HANDLE with SYNCHRONIZE access
+#else
+	i32 pidfd;		// -1 when pidfds are unavailable
+#endif
+} PlatformProcess;
+
+// === Placement ===
+typedef enum PlatformPriority {
+	PLATFORM_PRIORITY_UNCHANGED,
+	PLATFORM_PRIORITY_IDLE,
+	PLATFORM_PRIORITY_BELOW_NORMAL,
+	PLATFORM_PRIORITY_NORMAL,
+	PLATFORM_PRIORITY_ABOVE_NORMAL,
+	PLATFORM_PRIORITY_HIGH,
+} PlatformPriority;
+
+typedef struct PlatformPlacement {
+	u64 cpu_mask;				// bit n = CPU n; 0 leaves affinity unchanged
+	PlatformPriority priority;
+} PlatformPlacement;
+
+// Set the affinity and priority of every thread of pid (0 = this process).
+// Raising priority usually needs elevated rights; failures are logged.
+i32 platform_apply_placement(i64 pid, const PlatformPlacement* placement);
+
+// Start argv[0] with the given arguments in work_dir. A non-NULL placement is
+// applied before the game gets going: on Windows the process starts suspended
+// until it is placed, on Linux it is placed right after the spawn returns.
+i32 platform_spawn_process(i32 argc, char* argv[], const char* work_dir, const PlatformPlacement* placement, PlatformProcess* process);
+
+// Add a process to the tracked tree; the tree takes ownership of its handle.
+void platform_track_process(PlatformProcess* process);
+
+// Wait up to timeout_ms (-1 = no limit) for a tracked process to exit.
+// Processes a tracked launcher hands over to are followed automatically; on
+// Linux that covers every descendant, including re-parented orphans.
+// *drained is set once no tracked process remains.
+i32 platform_poll_process_tree(i32 timeout_ms, bool* drained);
+
+// === Event loop integration ===
+struct mg_mgr;
+
+// Wake mgr's event loop whenever a tracked process exits, so a single
+// mg_mgr_poll waits on OBS traffic and the game together. Processes tracked
+// later are registered as well. After a wakeup, platform_poll_process_tree
+// with a zero timeout does the bookkeeping.
+i32 platform_process_tree_attach(struct mg_mgr* mgr);
+
+// Must run before the manager is freed.
+void platform_process_tree_detach(void);
+
+// Longest event loop timeout that still notices every exit: -1 when all
+// tracked processes wake the loop, a fallback slice otherwise.
+i32 platform_process_tree_poll_interval_ms(void);
+
+// Sum of user and kernel CPU time of the tracked processes, in microseconds.
+// On Linux the live descendants of tracked processes count too, so a game
+// started by a launcher that is still running is included.
+// *all_stopped is set when every one of them is suspended (SIGSTOP).
+i32 platform_process_tree_cpu_time(u64* cpu_us, bool* all_stopped);
+
+// Resource usage summed over the same processes as the CPU time above.
+typedef struct PlatformProcessUsage {
+	u64 cpu_us;
+	u64 rss_bytes;
+	u64 read_bytes;		// bytes passed through read calls, cache hits included
+	u64 write_bytes;
+	u32 threads;		// 0 on Windows, where counting threads needs a snapshot
+	u32 processes;
+} PlatformProcessUsage;
+
+i32 platform_process_tree_usage(PlatformProcessUsage* usage);
+
+// Forget the scan history so the next scan treats every process as new.
+// Calling platform_scan_for_process once afterwards primes the history.
+void platform_scan_reset(void);
+
+// Incremental scan: only processes not seen by a previous scan are inspected.
+// Returns true and opens the first new process whose image path matches pattern.
+bool platform_scan_for_process(const char* pattern, PlatformProcess* process);
+
+i32 platform_is_process_running(const char* exe_name, bool* is_running);
+
+// Full scan for processes whose image path matches pattern; returns the count stored.
+i32 platform_find_processes(const char* pattern, i64* pids, i32 max_pids);
+
+// Start a detached helper program (used for OBS) without waiting for it.
+i32 platform_launch_detached(const char* exe_path, const char* args, const char* work_dir);
+
+// === File locks ===
+typedef struct PlatformFileLock {
+#ifdef _WIN32
+	void* handle;
+#else
+	i32 fd;
+#endif
+} PlatformFileLock;
+
+// Take an exclusive lock on path (created if missing) without waiting.
+// Returns non-zero when another process holds it. Locks die with the process,
+// so a crashed holder never leaves one behind.
+i32 platform_try_lock_file(const char* path, PlatformFileLock* lock);
+
+void platform_unlock_file(PlatformFileLock* lock);
+
+// === Files ===
+typedef struct PlatformMappedFile {
+	const u8* data;
+	u64 size;
+} PlatformMappedFile;
+
+// Map a whole file read-only. Empty files cannot be mapped.
+i32 platform_map_file(const char* path, PlatformMappedFile* file);
+
+void platform_unmap_file(PlatformMappedFile* file);
+
+// Last write time (in OS-specific units, only good for comparisons) and size.
+i32 platform_file_info(const char* path, i64* mtime, u64* size);
+
+// Call fn for every entry name in a directory until it returns false.
+i32 platform_list_dir(const char* path, bool (*fn)(const char* name, void* udata), void* udata);
+
+// Atomically move from over to, replacing any existing file.
+i32 platform_replace_file(const char* from, const char* to);
+
+// Steam client install folder, without a trailing separator.
+i32 platform_steam_root(char* output, i32 output_size);
+
+// === Misc ===
+u64 platform_monotonic_us(void);
+
+void platform_sleep_ms(u32 ms);
+
+i32 platform_executable_path(char* output, i32 output_size);
+
+// Per-user directory for scratch files such as locks, without a trailing
+// separator. On POSIX it is XDG_RUNTIME_DIR or a private (0700) directory
+// created under TMPDIR or /tmp.
+i32 platform_temp_dir(char* output, i32 output_size);
+
+// Keep the console open so errors stay readable when launched from Steam.
+void platform_pause(void);
@@ -0,0 +1,868 @@
+#ifndef _WIN32
+#include "platform.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+#include <time.h>
+#include <unistd.h>
+#include "log.h"
+#include "mongoose.h"
+#include "path.h"
+
+#ifndef PLATFORM_FALLBACK_POLL_MS
+#define PLATFORM_FALLBACK_POLL_MS 100
+#endif
+
+// Must be a power of two, comfortably above the live process count.
+#ifndef PLATFORM_SCAN_TABLE_SIZE
+#define PLATFORM_SCAN_TABLE_SIZE 32768
+#endif
+
+extern char** environ;
+
+// Direct children being waited on. With the subreaper bit set, every
+// descendant eventually becomes a direct child once its parent exits, so
+// the game session is over exactly when this set drains.
+// Processes found by a scan are tracked too but are not our children, so
+// they are dropped on pidfd readiness instead of being reaped.
+typedef struct ProcessTree {
+	i32 count;
+	pid_t pids[PLATFORM_MAX_TRACKED_PROCESSES];
+	i32 pidfds[PLATFORM_MAX_TRACKED_PROCESSES];
+	bool is_child[PLATFORM_MAX_TRACKED_PROCESSES];
+	bool watched[PLATFORM_MAX_TRACKED_PROCESSES];	// exit wakes the attached event loop
+	i32 detached_count;
+	pid_t detached[16];		// helpers such as OBS that must not keep the session alive
+} ProcessTree;
+
+static ProcessTree tree = { 0 };
+static struct mg_mgr* tree_mgr = NULL;
+
+// Open-addressed PID sets from the previous and the current /proc listing.
+// Swapping them each scan forgets PIDs that disappeared, so a later process
+// reusing one is inspected again.
+typedef struct ProcessScan {
+	u32 seen[2][PLATFORM_SCAN_TABLE_SIZE];
+	i32 current;
+	bool primed;
+} ProcessScan;
+
+static ProcessScan scan = { 0 };
+
+// === Process helpers ===
+// pidfds make process exit pollable; older kernels fall back to plain waitpid.
+static i32 open_pidfd(pid_t pid) {
+#ifdef SYS_pidfd_open
+	i32 fd = (i32)syscall(SYS_pidfd_open, pid, 0);
+	if (fd >= 0)
+		return fd;
+	log_debug("pidfd_open(%d) failed (errno %d)", (i32)pid, errno);
+#else
+	(void)pid;
+#endif
+	return -1;
+}
+
+static i32 spawn(const char* exe, char* const argv[], const char* work_dir, pid_t* pid) {
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	if (work_dir && *work_dir)
+		posix_spawn_file_actions_addchdir_np(&actions, work_dir);
+
+	i32 rc = posix_spawnp(pid, exe, &actions, NULL, argv, environ);
+	posix_spawn_file_actions_destroy(&actions);
+	if (rc != 0) {
+		log_error("posix_spawnp(%s) failed (errno %d)", exe, rc);
+		return 1;
+	}
+	return 0;
+}
+
+// === Placement ===
+static i32 priority_to_nice(PlatformPriority priority) {
+	switch (priority) {
+	case PLATFORM_PRIORITY_IDLE: return 19;
+	case PLATFORM_PRIORITY_BELOW_NORMAL: return 5;
+	case PLATFORM_PRIORITY_ABOVE_NORMAL: return -5;
+	case PLATFORM_PRIORITY_HIGH: return -10;
+	default: return 0;
+	}
+}
+
+static bool place_thread(pid_t tid, const PlatformPlacement* placement) {
+	bool ok = true;
+	if (placement->cpu_mask) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (i32 cpu = 0; cpu < 64; ++cpu) {
+			if (placement->cpu_mask & ((u64)1 << cpu))
+				CPU_SET(cpu, &set);
+		}
+		if (sched_setaffinity(tid, sizeof(set), &set) != 0)
+			ok = false;
+	}
+	// Linux nice values are per thread, so they are set alongside the affinity.
+	if (placement->priority != PLATFORM_PRIORITY_UNCHANGED && setpriority(PRIO_PROCESS, (id_t)tid, priority_to_nice(placement->priority)) != 0)
+		ok = false;
+	return ok;
+}
+
+i32 platform_apply_placement(i64 pid, const PlatformPlacement* placement) {
+	if (!placement->cpu_mask && placement->priority == PLATFORM_PRIORITY_UNCHANGED)
+		return 0;
+
+	char path[64];
+	if (pid == 0)
+		snprintf(path, sizeof(path), "/proc/self/task");
+	else
+		snprintf(path, sizeof(path), "/proc/%lld/task", pid);
+	DIR* tasks = opendir(path);
+	if (!tasks) {
+		log_warn("could not list threads of process %lld", pid);
+		return 1;
+	}
+
+	i32 failed = 0;
+	struct dirent* entry;
+	while ((entry = readdir(tasks)) != NULL) {
+		char* end;
+		long tid = strtol(entry->d_name, &end, 10);
+		if (*end != '\0' || tid <= 0)
+			continue;
+		if (!place_thread((pid_t)tid, placement))
+			failed = errno;
+	}
+	closedir(tasks);
+
+	if (failed) {
+		log_warn("could not fully place process %lld (errno %d)", pid, failed);
+		return 1;
+	}
+	return 0;
+}
+
+// === Processes ===
+i32 platform_spawn_process(i32 argc, char* argv[], const char* work_dir, const PlatformPlacement* placement, PlatformProcess* process) {
+	char** child_argv = malloc(sizeof(char*) * (argc + 1));
+	if (!child_argv)
+		return 1;
+	for (i32 i = 0; i < argc; ++i)
+		child_argv[i] = argv[i];
+	child_argv[argc] = NULL;
+
+#ifdef __linux__
+	// Become a subreaper so double-forked or grandchild game processes are
+	// re-parented to us instead of init and stay visible to the tree.
+	if (prctl(PR_SET_CHILD_SUBREAPER, 1) != 0)
+		log_warn("could not become child subreaper (errno %d)", errno);
+#endif
+
+	pid_t pid;
+	i32 err = spawn(argv[0], child_argv, work_dir, &pid);
+	free(child_argv);
+	if (err)
+		return err;
+
+	// posix_spawn returns once the game image is running, normally before it
+	// has started any threads of its own.
+	if (placement)
+		platform_apply_placement(pid, placement);
+
+	process->pid = pid;
+	process->pidfd = open_pidfd(pid);
+	return 0;
+}
+
+// === Process tree ===
+static bool tree_is_detached(pid_t pid) {
+	for (i32 i = 0; i < tree.detached_count; ++i) {
+		if (tree.detached[i] == pid)
+			return true;
+	}
+	return false;
+}
+
+static i32 tree_find(pid_t pid) {
+	for (i32 i = 0; i < tree.count; ++i) {
+		if (tree.pids[i] == pid)
+			return i;
+	}
+	return -1;
+}
+
+// === Event loop integration ===
+// A pidfd turns readable when its process exits and stays that way. Mongoose
+// would try to recv() from it, so the connection closes itself on the first
+// readiness; the tree keeps its own pidfd for platform_poll_process_tree.
+static void tree_exit_handler(struct mg_connection* c, int ev, void* ev_data) {
+	(void)ev_data;
+	if (ev == MG_EV_POLL && c->is_readable) {
+		c->is_readable = 0;
+		c->is_closing = 1;
+	}
+}
+
+static bool tree_watch(i32 pidfd) {
+	if (!tree_mgr || pidfd < 0)
+		return false;
+	i32 fd = fcntl(pidfd, F_DUPFD_CLOEXEC, 0);
+	if (fd < 0) {
+		log_warn("could not duplicate pidfd (errno %d)", errno);
+		return false;
+	}
+	if (!mg_wrapfd(tree_mgr, fd, tree_exit_handler, NULL)) {
+		close(fd);
+		return false;
+	}
+	return true;
+}
+
+static void tree_track(pid_t pid, i32 pidfd, bool is_child) {
+	if (tree_find(pid) >= 0 || tree_is_detached(pid)) {
+		if (pidfd >= 0)
+			close(pidfd);
+		return;
+	}
+	if (tree.count >= PLATFORM_MAX_TRACKED_PROCESSES) {
+		log_warn("process tree is full; not tracking %d", (i32)pid);
+		if (pidfd >= 0)
+			close(pidfd);
+		return;
+	}
+	tree.pids[tree.count] = pid;
+	tree.pidfds[tree.count] = pidfd;
+	tree.is_child[tree.count] = is_child;
+	tree.watched[tree.count] = tree_watch(pidfd);
+	tree.count++;
+}
+
+static void tree_untrack(pid_t pid) {
+	i32 i = tree_find(pid);
+	if (i < 0)
+		return;
+	if (tree.pidfds[i] >= 0)
+		close(tree.pidfds[i]);
+	tree.count--;
+	tree.pids[i] = tree.pids[tree.count];
+	tree.pidfds[i] = tree.pidfds[tree.count];
+	tree.is_child[i] = tree.is_child[tree.count];
+	tree.watched[i] = tree.watched[tree.count];
+}
+
+// Reap the tracked children that have exited, adopted orphans included,
+// without blocking. Only tracked PIDs are waited for, so other children of
+// the wrapper (detached helpers like OBS) keep their exit status for whoever
+// waits on them.
+static void tree_reap(void) {
+	for (i32 i = tree.count - 1; i >= 0; --i) {
+		if (!tree.is_child[i])
+			continue;
+		pid_t pid = tree.pids[i];
+		i32 status;
+		if (waitpid(pid, &status, WNOHANG) != pid)
+			continue;
+		if (WIFEXITED(status))
+			log_info("process %d exited with code %d", (i32)pid, WEXITSTATUS(status));
+		else if (WIFSIGNALED(status))
+			log_info("process %d killed by signal %d", (i32)pid, WTERMSIG(status));
+		tree_untrack(pid);
+	}
+}
+
+// Pick up orphans the kernel re-parented to us. Only our own children lists
+// are read, never the whole of /proc.
+static void tree_adopt(void) {
+	DIR* tasks = opendir("/proc/self/task");
+	if (!tasks)
+		return;
+
+	struct dirent* task;
+	while ((task = readdir(tasks)) != NULL) {
+		if (task->d_name[0] == '.')
+			continue;
+
+		char path[64];
+		snprintf(path, sizeof(path), "/proc/self/task/%.16s/children", task->d_name);
+		FILE* fp = fopen(path, "r");
+		if (!fp)
+			continue;
+		long pid;
+		while (fscanf(fp, "%ld", &pid) == 1) {
+			if (tree_find((pid_t)pid) >= 0 || tree_is_detached((pid_t)pid))
+				continue;
+			log_info("tracking descendant process %ld", pid);
+			tree_track((pid_t)pid, open_pidfd((pid_t)pid), true);
+		}
+		fclose(fp);
+	}
+	closedir(tasks);
+}
+
+// Non-children cannot be reaped; without a pidfd, probe them with signal 0.
+static void tree_drop_exited_strangers(const struct pollfd* fds, i32 nfds) {
+	for (i32 i = tree.count - 1; i >= 0; --i) {
+		if (tree.is_child[i])
+			continue;
+		bool exited = false;
+		if (tree.pidfds[i] < 0) {
+			exited = kill(tree.pids[i], 0) < 0 && errno == ESRCH;
+		} else {
+			for (i32 j = 0; j < nfds; ++j) {
+				if (fds[j].fd == tree.pidfds[i] && fds[j].revents)
+					exited = true;
+			}
+		}
+		if (exited) {
+			log_info("process %d exited", (i32)tree.pids[i]);
+			tree_untrack(tree.pids[i]);
+		}
+	}
+}
+
+// === Process tree API ===
+void platform_track_process(PlatformProcess* process) {
+	// Peek with WNOWAIT: a child that already exited stays a zombie, so the
+	// next reap still collects and logs its status. ECHILD means not ours.
+	pid_t pid = (pid_t)process->pid;
+	siginfo_t info;
+	memset(&info, 0, sizeof(info));
+	bool is_child = waitid(P_PID, (id_t)pid, &info, WEXITED | WNOHANG | WNOWAIT) == 0;
+	if (is_child && info.si_pid == pid)
+		log_warn("process %d exited before it was tracked", (i32)pid);
+	tree_track(pid, process->pidfd, is_child);
+	process->pidfd = -1;
+}
+
+// One poll over the pidfds of every tracked process. Each exit triggers a
+// reap and a re-read of our children lists, so a grandchild handed to us when
+// its launcher exits is picked up before we could decide the session is over.
+i32 platform_poll_process_tree(i32 timeout_ms, bool* drained) {
+	tree_reap();
+	tree_adopt();
+	tree_drop_exited_strangers(NULL, 0);
+	if (tree.count == 0) {
+		*drained = true;
+		if (timeout_ms > 0)
+			platform_sleep_ms((u32)timeout_ms);
+		return 0;
+	}
+
+	struct pollfd fds[PLATFORM_MAX_TRACKED_PROCESSES];
+	i32 nfds = 0;
+	bool fallback = false;
+	for (i32 i = 0; i < tree.count; ++i) {
+		if (tree.pidfds[i] < 0) {
+			fallback = true;
+			continue;
+		}
+		fds[nfds].fd = tree.pidfds[i];
+		fds[nfds].events = POLLIN;
+		fds[nfds].revents = 0;
+		nfds++;
+	}
+	// Without pidfds for every entry, fall back to short slices.
+	if (fallback && (timeout_ms < 0 || timeout_ms > PLATFORM_FALLBACK_POLL_MS))
+		timeout_ms = PLATFORM_FALLBACK_POLL_MS;
+
+	if (poll(fds, (nfds_t)nfds, timeout_ms) < 0 && errno != EINTR) {
+		log_error("poll on process tree failed (errno %d)", errno);
+		return 1;
+	}
+
+	tree_drop_exited_strangers(fds, nfds);
+	tree_reap();
+	tree_adopt();
+	*drained = tree.count == 0;
+	return 0;
+}
+
+i32 platform_process_tree_attach(struct mg_mgr* mgr) {
+	tree_mgr = mgr;
+	for (i32 i = 0; i < tree.count; ++i) {
+		if (!tree.watched[i])
+			tree.watched[i] = tree_watch(tree.pidfds[i]);
+	}
+	return 0;
+}
+
+void platform_process_tree_detach(void) {
+	tree_mgr = NULL;
+	for (i32 i = 0; i < tree.count; ++i)
+		tree.watched[i] = false;
+}
+
+i32 platform_process_tree_poll_interval_ms(void) {
+	for (i32 i = 0; i < tree.count; ++i) {
+		if (!tree.watched[i])
+			return PLATFORM_FALLBACK_POLL_MS;
+	}
+	return -1;
+}
+
+// === Process accounting ===
+// Parse utime/stime and the state letter from /proc/<pid>/stat. The command
+// name may contain spaces or parentheses, so fields are counted after the last ')'.
+typedef struct ProcStat {
+	char state;
+	u64 cpu_ticks;
+	u32 threads;
+	u64 rss_pages;
+} ProcStat;
+
+static bool read_proc_stat(pid_t pid, ProcStat* stat) {
+	char path[64], buf[512];
+	snprintf(path, sizeof(path), "/proc/%d/stat", (i32)pid);
+	FILE* fp = fopen(path, "r");
+	if (!fp)
+		return false;
+	u64 n = fread(buf, 1, sizeof(buf) - 1, fp);
+	fclose(fp);
+	buf[n] = '\0';
+
+	char* p = strrchr(buf, ')');
+	if (!p)
+		return false;
+	unsigned long long utime, stime, rss;
+	unsigned threads;
+	// state ppid pgrp session tty_nr tpgid flags minflt cminflt majflt cmajflt utime stime
+	// cutime cstime priority nice num_threads itrealvalue starttime vsize rss
+	if (sscanf(p + 2, "%c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu %*d %*d %*d %*d %u %*d %*u %*u %llu",
+			   &stat->state, &utime, &stime, &threads, &rss) != 5)
+		return false;
+	stat->cpu_ticks = utime + stime;
+	stat->threads = threads;
+	stat->rss_pages = rss;
+	return true;
+}
+
+// rchar/wchar count every byte read or written, matching the Windows transfer counters.
+// Only readable for processes we may ptrace; otherwise the counters stay zero.
+static void read_proc_io(pid_t pid, u64* read_bytes, u64* write_bytes) {
+	char path[64], buf[512];
+	snprintf(path, sizeof(path), "/proc/%d/io", (i32)pid);
+	FILE* fp = fopen(path, "r");
+	if (!fp)
+		return;
+	u64 n = fread(buf, 1, sizeof(buf) - 1, fp);
+	fclose(fp);
+	buf[n] = '\0';
+
+	unsigned long long rchar, wchar;
+	if (sscanf(buf, "rchar: %llu wchar: %llu", &rchar, &wchar) == 2) {
+		*read_bytes += rchar;
+		*write_bytes += wchar;
+	}
+}
+
+static u64 ticks_to_us(u64 ticks) {
+	static long ticks_per_second = 0;
+	if (ticks_per_second <= 0)
+		ticks_per_second = sysconf(_SC_CLK_TCK);
+	return ticks * 1000000 / (u64)ticks_per_second;
+}
+
+// Tracked processes plus every live descendant. A process's stat only counts
+// its own threads and reaped children, so while a Steam or Proton launcher is
+// alive the game, its grandchild, is only seen by walking the tree.
+#ifndef PLATFORM_MAX_DESCENDANTS
+#define PLATFORM_MAX_DESCENDANTS 1024
+#endif
+
+typedef struct Descendants {
+	i32 count;
+	pid_t pids[PLATFORM_MAX_DESCENDANTS];
+} Descendants;
+
+static void descendants_add(Descendants* set, pid_t pid) {
+	if (tree_is_detached(pid) || set->count >= PLATFORM_MAX_DESCENDANTS)
+		return;
+	for (i32 i = 0; i < set->count; ++i) {
+		if (set->pids[i] == pid)
+			return;
+	}
+	set->pids[set->count++] = pid;
+}
+
+// Each thread lists the children it forked in /proc/<pid>/task/<tid>/children.
+static void descendants_add_children(Descendants* set, pid_t pid) {
+	char path[64];
+	snprintf(path, sizeof(path), "/proc/%d/task", (i32)pid);
+	DIR* dir = opendir(path);
+	if (!dir)
+		return;
+	struct dirent* entry;
+	while ((entry = readdir(dir)) != NULL) {
+		if (entry->d_name[0] < '0' || entry->d_name[0] > '9')
+			continue;
+		char children_path[128];
+		snprintf(children_path, sizeof(children_path), "%s/%.32s/children", path, entry->d_name);
+		FILE* fp = fopen(children_path, "r");
+		if (!fp)
+			continue;
+		long child;
+		while (fscanf(fp, "%ld", &child) == 1)
+			descendants_add(set, (pid_t)child);
+		fclose(fp);
+	}
+	closedir(dir);
+}
+
+// Breadth first: the loop walks the entries it appends.
+static const Descendants* collect_descendants(void) {
+	static Descendants set;
+	set.count = 0;
+	for (i32 i = 0; i < tree.count; ++i)
+		descendants_add(&set, tree.pids[i]);
+	for (i32 i = 0; i < set.count; ++i)
+		descendants_add_children(&set, set.pids[i]);
+	return &set;
+}
+
+i32 platform_process_tree_cpu_time(u64* cpu_us, bool* all_stopped) {
+	const Descendants* set = collect_descendants();
+	u64 total_ticks = 0;
+	bool stopped = set->count > 0;
+	for (i32 i = 0; i < set->count; ++i) {
+		ProcStat stat;
+		if (!read_proc_stat(set->pids[i], &stat))
+			continue;
+		total_ticks += stat.cpu_ticks;
+		if (stat.state != 'T' && stat.state != 't')
+			stopped = false;
+	}
+
+	*cpu_us = ticks_to_us(total_ticks);
+	*all_stopped = stopped;
+	return 0;
+}
+
+i32 platform_process_tree_usage(PlatformProcessUsage* usage) {
+	static long page_size = 0;
+	if (page_size <= 0)
+		page_size = sysconf(_SC_PAGESIZE);
+
+	memset(usage, 0, sizeof(*usage));
+	const Descendants* set = collect_descendants();
+	u64 total_ticks = 0;
+	for (i32 i = 0; i < set->count; ++i) {
+		ProcStat stat;
+		if (!read_proc_stat(set->pids[i], &stat))
+			continue;
+		total_ticks += stat.cpu_ticks;
+		usage->rss_bytes += stat.rss_pages * (u64)page_size;
+		usage->threads += stat.threads;
+		usage->processes++;
+		read_proc_io(set->pids[i], &usage->read_bytes, &usage->write_bytes);
+	}
+	usage->cpu_us = ticks_to_us(total_ticks);
+	return 0;
+}
+
+// === Process scan ===
+// Table entries are (pid << 1) | settled. A PID is inspected in the first two
+// scans that see it, which catches a fork that execs the game a moment later.
+static u32 scan_hash(u32 pid) {
+	return (u32)(pid * 2654435761u) & (PLATFORM_SCAN_TABLE_SIZE - 1);
+}
+
+static void scan_insert(u32* table, u32 pid, bool settled) {
+	for (u32 i = scan_hash(pid), n = 0; n < PLATFORM_SCAN_TABLE_SIZE; i = (i + 1) & (PLATFORM_SCAN_TABLE_SIZE - 1), ++n) {
+		if (table[i] == 0 || table[i] >> 1 == pid) {
+			table[i] = (pid << 1) | (settled ? 1 : 0);
+			return;
+		}
+	}
+}
+
+// Returns 0 when absent, 1 when seen once, 2 when settled.
+static i32 scan_lookup(const u32* table, u32 pid) {
+	for (u32 i = scan_hash(pid), n = 0; n < PLATFORM_SCAN_TABLE_SIZE; i = (i + 1) & (PLATFORM_SCAN_TABLE_SIZE - 1), ++n) {
+		if (table[i] == 0)
+			return 0;
+		if (table[i] >> 1 == pid)
+			return (table[i] & 1) ? 2 : 1;
+	}
+	return 0;
+}
+
+// Match the executable link first, then argv[0] so Wine/Proton games, whose
+// exe is the Wine loader, are found by their Windows path.
+static bool scan_inspect(u32 pid, const char* pattern) {
+	char path[64], image[1024];
+	snprintf(path, sizeof(path), "/proc/%u/exe", pid);
+	ssize_t len = readlink(path, image, sizeof(image) - 1);
+	if (len <= 0)
+		return false;	// kernel thread or not ours to inspect
+	image[len] = '\0';
+	if (path_matches_pattern(image, pattern))
+		return true;
+
+	snprintf(path, sizeof(path), "/proc/%u/cmdline", pid);
+	FILE* fp = fopen(path, "r");
+	if (!fp)
+		return false;
+	u64 n = fread(image, 1, sizeof(image) - 1, fp);
+	fclose(fp);
+	image[n] = '\0';	// cmdline is NUL-separated, so this ends at argv[0]
+	return n > 0 && path_matches_pattern(image, pattern);
+}
+
+void platform_scan_reset(void) {
+	memset(&scan, 0, sizeof(scan));
+}
+
+bool platform_scan_for_process(const char* pattern, PlatformProcess* process) {
+	DIR* proc = opendir("/proc");
+	if (!proc)
+		return false;
+
+	u32* previous = scan.seen[scan.current];
+	u32* next = scan.seen[scan.current ^ 1];
+	memset(next, 0, sizeof(scan.seen[0]));
+
+	bool found = false;
+	struct dirent* entry;
+	while ((entry = readdir(proc)) != NULL) {
+		char* end;
+		unsigned long pid = strtoul(entry->d_name, &end, 10);
+		if (*end != '\0' || pid == 0)
+			continue;
+
+		i32 state = scan_lookup(previous, (u32)pid);
+		scan_insert(next, (u32)pid, !scan.primed || state > 0);
+		if (found || !scan.primed || state == 2)
+			continue;
+		if (!scan_inspect((u32)pid, pattern))
+			continue;
+
+		log_info("process %lu matches '%s'", pid, pattern);
+		process->pid = (i64)pid;
+		process->pidfd = open_pidfd((pid_t)pid);
+		found = true;
+	}
+	closedir(proc);
+
+	scan.current ^= 1;
+	scan.primed = true;
+	return found;
+}
+
+// === Process lookup ===
+// Check for an existing process by its /proc/<pid>/comm name.
+i32 platform_is_process_running(const char* exe_name, bool* is_running) {
+	DIR* proc = opendir("/proc");
+	if (!proc) {
+		return 1;
+	}
+
+	bool found = false;
+	struct dirent* entry;
+	while (!found && (entry = readdir(proc)) != NULL) {
+		char* end;
+		long pid = strtol(entry->d_name, &end, 10);
+		if (*end != '\0' || pid <= 0)
+			continue;
+
+		char path[64], comm[64];
+		snprintf(path, sizeof(path), "/proc/%ld/comm", pid);
+		FILE* fp = fopen(path, "r");
+		if (!fp)
+			continue;
+		if (fgets(comm, sizeof(comm), fp)) {
+			comm[strcspn(comm, "\n")] = '\0';
+			// comm is truncated to 15 characters by the kernel
+			found = strncmp(comm, exe_name, 15) == 0;
+		}
+		fclose(fp);
+	}
+
+	closedir(proc);
+	*is_running = found;
+	return 0;
+}
+
+i32 platform_find_processes(const char* pattern, i64* pids, i32 max_pids) {
+	DIR* proc = opendir("/proc");
+	if (!proc)
+		return 0;
+
+	i32 count = 0;
+	struct dirent* entry;
+	while (count < max_pids && (entry = readdir(proc)) != NULL) {
+		char* end;
+		unsigned long pid = strtoul(entry->d_name, &end, 10);
+		if (*end != '\0' || pid == 0)
+			continue;
+		if (scan_inspect((u32)pid, pattern))
+			pids[count++] = (i64)pid;
+	}
+	closedir(proc);
+	return count;
+}
+
+i32 platform_launch_detached(const char* exe_path, const char* args, const char* work_dir) {
+	char* argv[] = { (char*)exe_path, (char*)args, NULL };
+	pid_t pid;
+	i32 err = spawn(exe_path, argv, work_dir, &pid);
+	if (!err && tree.detached_count < (i32)(sizeof(tree.detached) / sizeof(tree.detached[0])))
+		tree.detached[tree.detached_count++] = pid;
+	return err;
+}
+
+// === File locks ===
+// O_NOFOLLOW: lock names are predictable, so a symlink planted in their place
+// must not redirect the open to another file.
+i32 platform_try_lock_file(const char* path, PlatformFileLock* lock) {
+	i32 fd = open(path, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600);
+	if (fd < 0) {
+		log_error("could not open lock file %s (errno %d)", path, errno);
+		return 1;
+	}
+	if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+		close(fd);
+		return 1;
+	}
+	lock->fd = fd;
+	return 0;
+}
+
+void platform_unlock_file(PlatformFileLock* lock) {
+	if (lock->fd >= 0)
+		close(lock->fd);
+	lock->fd = -1;
+}
+
+// === Files ===
+i32 platform_map_file(const char* path, PlatformMappedFile* file) {
+	i32 fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return 1;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+		close(fd);
+		return 1;
+	}
+	void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return 1;
+	file->data = data;
+	file->size = (u64)st.st_size;
+	return 0;
+}
+
+void platform_unmap_file(PlatformMappedFile* file) {
+	if (file->data)
+		munmap((void*)file->data, (size_t)file->size);
+	file->data = NULL;
+	file->size = 0;
+}
+
+i32 platform_file_info(const char* path, i64* mtime, u64* size) {
+	struct stat st;
+	if (stat(path, &st) != 0)
+		return 1;
+	*mtime = (i64)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+	*size = (u64)st.st_size;
+	return 0;
+}
+
+i32 platform_list_dir(const char* path, bool (*fn)(const char* name, void* udata), void* udata) {
+	DIR* dir = opendir(path);
+	if (!dir)
+		return 1;
+	struct dirent* entry;
+	while ((entry = readdir(dir)) != NULL) {
+		if (!fn(entry->d_name, udata))
+			break;
+	}
+	closedir(dir);
+	return 0;
+}
+
+i32 platform_replace_file(const char* from, const char* to) {
+	return rename(from, to) != 0;
+}
+
+i32 platform_steam_root(char* output, i32 output_size) {
+	const char* home = getenv("HOME");
+	if (!home || !*home)
+		return 1;
+	static const char* candidates[] = { "/.local/share/Steam", "/.steam/steam" };
+	for (u64 i = 0; i < sizeof(candidates) / sizeof(candidates[0]); ++i) {
+		snprintf(output, (u64)output_size, "%s%s", home, candidates[i]);
+		struct stat st;
+		if (stat(output, &st) == 0 && S_ISDIR(st.st_mode))
+			return 0;
+	}
+	return 1;
+}
+
+// === Misc ===
+u64 platform_monotonic_us(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * 1000000 + (u64)ts.tv_nsec / 1000;
+}
+
+void platform_sleep_ms(u32 ms) {
+	struct timespec ts = { (time_t)(ms / 1000), (long)(ms % 1000) * 1000000 };
+	while (nanosleep(&ts, &ts) < 0 && errno == EINTR)
+		;
+}
+
+i32 platform_executable_path(char* output, i32 output_size) {
+	ssize_t len = readlink("/proc/self/exe", output, output_size - 1);
+	if (len <= 0)
+		return 1;
+	output[len] = '\0';
+	return 0;
+}
+
+// XDG_RUNTIME_DIR is private to the user already. Otherwise the shared temp
+// directory gets a smart_grecording-<uid> subdirectory, used only while it is
+// a real directory owned by us and closed to everyone else.
+i32 platform_temp_dir(char* output, i32 output_size) {
+	const char* dir = getenv("XDG_RUNTIME_DIR");
+	if (dir && *dir)
+		return snprintf(output, (u64)output_size, "%s", dir) >= output_size;
+	dir = getenv("TMPDIR");
+	if (!dir || !*dir)
+		dir = "/tmp";
+	uid_t uid = getuid();
+	if (snprintf(output, (u64)output_size, "%s/smart_grecording-%u", dir, (u32)uid) >= output_size)
+		return 1;
+	if (mkdir(output, 0700) != 0 && errno != EEXIST) {
+		log_error("could not create %s (errno %d)", output, errno);
+		return 1;
+	}
+	struct stat st;
+	if (lstat(output, &st) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != uid || (st.st_mode & 077) != 0) {
+		log_error("%s is not a private directory owned by this user", output);
+		return 1;
+	}
+	return 0;
+}
+
+void platform_pause(void) {
+	if (!isatty(STDIN_FILENO))
+		return;
+	printf("Press Enter to continue . . .");
+	fflush(stdout);
+	getchar();
+}
+#endif
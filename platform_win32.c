@@ -0,0 +1,584 @@
+#ifdef _WIN32
+#include "platform.h"
+#include "mongoose.h"
+#include <windows.h>
+#include <psapi.h>
+#include <shellapi.h>
+#include <stdlib.h>
+#include <TlHelp32.h>
+#include <wchar.h>
+#include "log.h"
+#include "path.h"
+
+// Tracked processes. WaitForMultipleObjects caps a single wait at 64 handles.
+typedef struct ProcessTree {
+	i32 count;
+	HANDLE handles[MAXIMUM_WAIT_OBJECTS];
+	DWORD pids[MAXIMUM_WAIT_OBJECTS];
+	HANDLE waits[MAXIMUM_WAIT_OBJECTS];		// thread-pool waits that wake the event loop
+} ProcessTree;
+
+static ProcessTree tree = { 0 };
+
+// Process handles cannot join mongoose's select(), so a thread-pool wait per
+// process sends an mg_wakeup() to this placeholder connection instead.
+typedef struct ProcessTreeLoop {
+	struct mg_mgr* mgr;
+	unsigned long wake_id;
+} ProcessTreeLoop;
+
+static ProcessTreeLoop tree_loop = { 0 };
+
+#ifndef PLATFORM_FALLBACK_POLL_MS
+#define PLATFORM_FALLBACK_POLL_MS 100
+#endif
+
+#ifndef PLATFORM_SCAN_TABLE_SIZE
+#define PLATFORM_SCAN_TABLE_SIZE 32768
+#endif
+
+// PID sets from the previous and the current snapshot; see platform_posix.c.
+typedef struct ProcessScan {
+	DWORD seen[2][PLATFORM_SCAN_TABLE_SIZE];
+	i32 current;
+	bool primed;
+} ProcessScan;
+
+static ProcessScan scan = { 0 };
+
+// === Process helpers ===
+// Snapshot current processes to find a direct child of the launcher.
+static bool try_open_child_process(DWORD parent_pid, PlatformProcess* child_info) {
+	HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+	if (snapshot == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	PROCESSENTRY32W entry;
+	entry.dwSize = sizeof(PROCESSENTRY32W);
+
+	if (!Process32FirstW(snapshot, &entry)) {
+		CloseHandle(snapshot);
+		return false;
+	}
+
+	HANDLE child = NULL;
+	do {
+		if (entry.th32ParentProcessID == parent_pid) {
+			log_info("found child process %ld: %ls", entry.th32ProcessID, entry.szExeFile);
+			child = OpenProcess(SYNCHRONIZE | PROCESS_QUERY_INFORMATION, FALSE, entry.th32ProcessID);
+			if (child) {
+				child_info->handle = child;
+				child_info->pid = entry.th32ProcessID;
+				break;
+			}
+		}
+	} while (Process32NextW(snapshot, &entry));
+
+
+	CloseHandle(snapshot);
+	return child != NULL;
+}
+
+// === Placement ===
+static DWORD priority_to_class(PlatformPriority priority) {
+	switch (priority) {
+	case PLATFORM_PRIORITY_IDLE: return IDLE_PRIORITY_CLASS;
+	case PLATFORM_PRIORITY_BELOW_NORMAL: return BELOW_NORMAL_PRIORITY_CLASS;
+	case PLATFORM_PRIORITY_ABOVE_NORMAL: return ABOVE_NORMAL_PRIORITY_CLASS;
+	case PLATFORM_PRIORITY_HIGH: return HIGH_PRIORITY_CLASS;
+	default: return NORMAL_PRIORITY_CLASS;
+	}
+}
+
+// Affinity and priority class are process-wide on Windows.
+static i32 place_process(HANDLE process, const PlatformPlacement* placement) {
+	i32 err = 0;
+	if (placement->cpu_mask && !SetProcessAffinityMask(process, (DWORD_PTR)placement->cpu_mask))
+		err = 1;
+	if (placement->priority != PLATFORM_PRIORITY_UNCHANGED && !SetPriorityClass(process, priority_to_class(placement->priority)))
+		err = 1;
+	return err;
+}
+
+i32 platform_apply_placement(i64 pid, const PlatformPlacement* placement) {
+	if (!placement->cpu_mask && placement->priority == PLATFORM_PRIORITY_UNCHANGED)
+		return 0;
+
+	HANDLE process = pid == 0 ? GetCurrentProcess() : OpenProcess(PROCESS_SET_INFORMATION | PROCESS_QUERY_LIMITED_INFORMATION, FALSE, (DWORD)pid);
+	if (!process) {
+		log_warn("could not open process %lld for placement (error %lu)", pid, GetLastError());
+		return 1;
+	}
+	i32 err = place_process(process, placement);
+	if (err)
+		log_warn("could not fully place process %lld (error %lu)", pid, GetLastError());
+	if (pid != 0)
+		CloseHandle(process);
+	return err;
+}
+
+// === Processes ===
+// Rebuilds the original CLI into a single quoted command line for CreateProcessA.
+// With a placement the game starts suspended so none of its threads run unplaced.
+i32 platform_spawn_process(i32 argc, char* argv[], const char* work_dir, const PlatformPlacement* placement, PlatformProcess* process) {
+	char command_line[2048] = "";
+	for (i32 i = 0; i < argc; ++i) {
+		strcat_s(command_line, sizeof(command_line), "\"");
+		strcat_s(command_line, sizeof(command_line), argv[i]);
+		strcat_s(command_line, sizeof(command_line), "\"");
+		if (i < argc - 1) {
+			strcat_s(command_line, sizeof(command_line), " ");
+		}
+	}
+
+	STARTUPINFOA si;
+	PROCESS_INFORMATION pi;
+	ZeroMemory(&si, sizeof(si));
+	ZeroMemory(&pi, sizeof(pi));
+	si.cb = sizeof(si);
+	DWORD flags = placement ? CREATE_SUSPENDED : 0;
+	BOOL rc = CreateProcessA(NULL, command_line, NULL, NULL, FALSE, flags, NULL, work_dir, &si, &pi);
+	if (rc == 0) {
+		log_error("CreateProcessA failed (error %lu)", GetLastError());
+		return 1;
+	}
+
+	if (placement) {
+		if (place_process(pi.hProcess, placement))
+			log_warn("could not fully place game process (error %lu)", GetLastError());
+		ResumeThread(pi.hThread);
+	}
+	CloseHandle(pi.hThread);
+	process->pid = pi.dwProcessId;
+	process->handle = pi.hProcess;
+	return 0;
+}
+
+// === Event loop integration ===
+static void tree_loop_handler(struct mg_connection* c, int ev, void* ev_data) {
+	(void)c;
+	(void)ev;
+	(void)ev_data;	// the wakeup itself is the message
+}
+
+static VOID CALLBACK tree_exit_callback(PVOID context, BOOLEAN timed_out) {
+	(void)context;
+	(void)timed_out;
+	mg_wakeup(tree_loop.mgr, tree_loop.wake_id, "", 0);
+}
+
+static HANDLE tree_watch(HANDLE process) {
+	HANDLE wait = NULL;
+	if (tree_loop.mgr && !RegisterWaitForSingleObject(&wait, process, tree_exit_callback, NULL, INFINITE, WT_EXECUTEONLYONCE)) {
+		log_warn("RegisterWaitForSingleObject failed (error %lu)", GetLastError());
+		wait = NULL;
+	}
+	return wait;
+}
+
+static void tree_unwatch(i32 i, bool blocking) {
+	if (tree.waits[i])
+		UnregisterWaitEx(tree.waits[i], blocking ? INVALID_HANDLE_VALUE : NULL);
+	tree.waits[i] = NULL;
+}
+
+i32 platform_process_tree_attach(struct mg_mgr* mgr) {
+	if (!mg_wakeup_init(mgr)) {
+		log_error("could not set up event loop wakeups");
+		return 1;
+	}
+	struct mg_connection* c = mg_wrapfd(mgr, (int)MG_INVALID_SOCKET, tree_loop_handler, NULL);
+	if (!c)
+		return 1;
+	tree_loop.mgr = mgr;
+	tree_loop.wake_id = c->id;
+	for (i32 i = 0; i < tree.count; ++i) {
+		if (!tree.waits[i])
+			tree.waits[i] = tree_watch(tree.handles[i]);
+	}
+	return 0;
+}
+
+// Waits for in-flight callbacks, which still reference the manager.
+void platform_process_tree_detach(void) {
+	for (i32 i = 0; i < tree.count; ++i)
+		tree_unwatch(i, true);
+	tree_loop.mgr = NULL;
+}
+
+i32 platform_process_tree_poll_interval_ms(void) {
+	for (i32 i = 0; i < tree.count; ++i) {
+		if (!tree.waits[i])
+			return PLATFORM_FALLBACK_POLL_MS;
+	}
+	return -1;
+}
+
+// === Process tree ===
+static void tree_track(DWORD pid, HANDLE handle) {
+	for (i32 i = 0; i < tree.count; ++i) {
+		if (tree.pids[i] == pid) {
+			CloseHandle(handle);
+			return;
+		}
+	}
+	if (tree.count >= MAXIMUM_WAIT_OBJECTS) {
+		log_warn("process tree is full; not tracking %lu", pid);
+		CloseHandle(handle);
+		return;
+	}
+	tree.handles[tree.count] = handle;
+	tree.pids[tree.count] = pid;
+	tree.waits[tree.count] = tree_watch(handle);
+	tree.count++;
+}
+
+void platform_track_process(PlatformProcess* process) {
+	tree_track((DWORD)process->pid, process->handle);
+	process->handle = NULL;
+}
+
+// Wait for any tracked process, then follow a child it spawned (launchers that exit quickly).
+i32 platform_poll_process_tree(i32 timeout_ms, bool* drained) {
+	if (tree.count == 0) {
+		*drained = true;
+		if (timeout_ms > 0)
+			Sleep((DWORD)timeout_ms);
+		return 0;
+	}
+
+	DWORD rc = WaitForMultipleObjects((DWORD)tree.count, tree.handles, FALSE, timeout_ms < 0 ? INFINITE : (DWORD)timeout_ms);
+	if (rc == WAIT_FAILED) {
+		log_error("WaitForMultipleObjects failed (error %lu)", GetLastError());
+		return 1;
+	}
+	if (rc < WAIT_OBJECT_0 + (DWORD)tree.count) {
+		i32 i = (i32)(rc - WAIT_OBJECT_0);
+		DWORD pid = tree.pids[i];
+		tree_unwatch(i, false);
+		CloseHandle(tree.handles[i]);
+		tree.count--;
+		tree.handles[i] = tree.handles[tree.count];
+		tree.pids[i] = tree.pids[tree.count];
+		tree.waits[i] = tree.waits[tree.count];
+
+		PlatformProcess child;
+		if (try_open_child_process(pid, &child))
+			platform_track_process(&child);
+	}
+
+	*drained = tree.count == 0;
+	return 0;
+}
+
+// === Process accounting ===
+static u64 filetime_us(FILETIME time) {
+	return ((u64)time.dwHighDateTime << 32 | time.dwLowDateTime) / 10;	// 100 ns units
+}
+
+// Suspension is not observable cheaply here, so *all_stopped stays false.
+i32 platform_process_tree_cpu_time(u64* cpu_us, bool* all_stopped) {
+	u64 total = 0;
+	for (i32 i = 0; i < tree.count; ++i) {
+		FILETIME created, exited, kernel, user;
+		if (!GetProcessTimes(tree.handles[i], &created, &exited, &kernel, &user))
+			continue;
+		total += filetime_us(kernel) + filetime_us(user);
+	}
+	*cpu_us = total;
+	*all_stopped = false;
+	return 0;
+}
+
+i32 platform_process_tree_usage(PlatformProcessUsage* usage) {
+	memset(usage, 0, sizeof(*usage));
+	for (i32 i = 0; i < tree.count; ++i) {
+		FILETIME created, exited, kernel, user;
+		if (!GetProcessTimes(tree.handles[i], &created, &exited, &kernel, &user))
+			continue;
+		usage->cpu_us += filetime_us(kernel) + filetime_us(user);
+		usage->processes++;
+
+		PROCESS_MEMORY_COUNTERS memory;
+		if (GetProcessMemoryInfo(tree.handles[i], &memory, sizeof(memory)))
+			usage->rss_bytes += memory.WorkingSetSize;
+		IO_COUNTERS io;
+		if (GetProcessIoCounters(tree.handles[i], &io)) {
+			usage->read_bytes += io.ReadTransferCount;
+			usage->write_bytes += io.WriteTransferCount;
+		}
+	}
+	return 0;
+}
+
+// === Process scan ===
+// Table entries are (pid << 1) | settled. A PID is inspected in the first two
+// scans that see it, which catches a fork that execs the game a moment later.
+static u32 scan_hash(DWORD pid) {
+	return (u32)((pid >> 2) * 2654435761u) & (PLATFORM_SCAN_TABLE_SIZE - 1);
+}
+
+static void scan_insert(DWORD* table, DWORD pid, bool settled) {
+	for (u32 i = scan_hash(pid), n = 0; n < PLATFORM_SCAN_TABLE_SIZE; i = (i + 1) & (PLATFORM_SCAN_TABLE_SIZE - 1), ++n) {
+		if (table[i] == 0 || table[i] >> 1 == pid) {
+			table[i] = (pid << 1) | (settled ? 1 : 0);
+			return;
+		}
+	}
+}
+
+// Returns 0 when absent, 1 when seen once, 2 when settled.
+static i32 scan_lookup(const DWORD* table, DWORD pid) {
+	for (u32 i = scan_hash(pid), n = 0; n < PLATFORM_SCAN_TABLE_SIZE; i = (i + 1) & (PLATFORM_SCAN_TABLE_SIZE - 1), ++n) {
+		if (table[i] == 0)
+			return 0;
+		if (table[i] >> 1 == pid)
+			return (table[i] & 1) ? 2 : 1;
+	}
+	return 0;
+}
+
+void platform_scan_reset(void) {
+	memset(&scan, 0, sizeof(scan));
+}
+
+// Toolhelp snapshots are all-or-nothing, but only unseen PIDs are opened
+// to read their full image path.
+bool platform_scan_for_process(const char* pattern, PlatformProcess* process) {
+	HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+	if (snapshot == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	PROCESSENTRY32W entry;
+	entry.dwSize = sizeof(PROCESSENTRY32W);
+	if (!Process32FirstW(snapshot, &entry)) {
+		CloseHandle(snapshot);
+		return false;
+	}
+
+	DWORD* previous = scan.seen[scan.current];
+	DWORD* next = scan.seen[scan.current ^ 1];
+	memset(next, 0, sizeof(scan.seen[0]));
+
+	bool found = false;
+	do {
+		DWORD pid = entry.th32ProcessID;
+		if (pid == 0)
+			continue;
+		i32 state = scan_lookup(previous, pid);
+		scan_insert(next, pid, !scan.primed || state > 0);
+		if (found || !scan.primed || state == 2)
+			continue;
+
+		HANDLE handle = OpenProcess(SYNCHRONIZE | PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+		if (!handle)
+			continue;
+		char image[MAX_PATH * 2];
+		DWORD image_len = sizeof(image);
+		if (QueryFullProcessImageNameA(handle, 0, image, &image_len) && path_matches_pattern(image, pattern)) {
+			log_info("process %lu matches '%s'", pid, pattern);
+			process->pid = pid;
+			process->handle = handle;
+			found = true;
+		} else {
+			CloseHandle(handle);
+		}
+	} while (Process32NextW(snapshot, &entry));
+
+	CloseHandle(snapshot);
+	scan.current ^= 1;
+	scan.primed = true;
+	return found;
+}
+
+// === Process lookup ===
+// Check for an existing process by executable name.
+i32 platform_is_process_running(const char* exe_name, bool* is_running) {
+	wchar_t wide_name[MAX_PATH];
+	if (!MultiByteToWideChar(CP_UTF8, 0, exe_name, -1, wide_name, MAX_PATH)) {
+		return 1;
+	}
+
+	HANDLE process_snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+	if (process_snapshot == INVALID_HANDLE_VALUE) {
+		return 1;
+	}
+
+	PROCESSENTRY32W process_entry;
+	process_entry.dwSize = sizeof(PROCESSENTRY32W);
+
+	if (!Process32FirstW(process_snapshot, &process_entry)) {
+		CloseHandle(process_snapshot);
+		return 1;
+	}
+
+	bool found = false;
+	do {
+		if (wcscmp(process_entry.szExeFile, wide_name) == 0) {
+			found = true;
+			break;
+		}
+	} while (Process32NextW(process_snapshot, &process_entry));
+
+	CloseHandle(process_snapshot);
+	*is_running = found;
+	return 0;
+}
+
+i32 platform_find_processes(const char* pattern, i64* pids, i32 max_pids) {
+	HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+	if (snapshot == INVALID_HANDLE_VALUE) {
+		return 0;
+	}
+
+	PROCESSENTRY32W entry;
+	entry.dwSize = sizeof(PROCESSENTRY32W);
+	if (!Process32FirstW(snapshot, &entry)) {
+		CloseHandle(snapshot);
+		return 0;
+	}
+
+	i32 count = 0;
+	do {
+		HANDLE handle = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, entry.th32ProcessID);
+		if (!handle)
+			continue;
+		char image[MAX_PATH * 2];
+		DWORD image_len = sizeof(image);
+		if (QueryFullProcessImageNameA(handle, 0, image, &image_len) && path_matches_pattern(image, pattern))
+			pids[count++] = entry.th32ProcessID;
+		CloseHandle(handle);
+	} while (count < max_pids && Process32NextW(snapshot, &entry));
+
+	CloseHandle(snapshot);
+	return count;
+}
+
+i32 platform_launch_detached(const char* exe_path, const char* args, const char* work_dir) {
+	HINSTANCE result = ShellExecuteA(NULL, "open", exe_path, args, work_dir, SW_SHOWNORMAL);
+	if ((intptr_t)result <= 32) {
+		log_error("ShellExecuteA failed (code: %Id)", (intptr_t)result);
+		return 1;
+	}
+	return 0;
+}
+
+// === File locks ===
+// Opening for write without sharing write access is the lock itself.
+i32 platform_try_lock_file(const char* path, PlatformFileLock* lock) {
+	HANDLE file = CreateFileA(path, GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		if (GetLastError() != ERROR_SHARING_VIOLATION)
+			log_error("could not open lock file %s (error %lu)", path, GetLastError());
+		return 1;
+	}
+	lock->handle = file;
+	return 0;
+}
+
+void platform_unlock_file(PlatformFileLock* lock) {
+	if (lock->handle)
+		CloseHandle(lock->handle);
+	lock->handle = NULL;
+}
+
+// === Files ===
+// The view keeps the mapping alive, so both handles can go right away.
+i32 platform_map_file(const char* path, PlatformMappedFile* file) {
+	HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (handle == INVALID_HANDLE_VALUE)
+		return 1;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(handle, &size) || size.QuadPart <= 0) {
+		CloseHandle(handle);
+		return 1;
+	}
+	HANDLE mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(handle);
+	if (!mapping)
+		return 1;
+	const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (!data)
+		return 1;
+	file->data = data;
+	file->size = (u64)size.QuadPart;
+	return 0;
+}
+
+void platform_unmap_file(PlatformMappedFile* file) {
+	if (file->data)
+		UnmapViewOfFile(file->data);
+	file->data = NULL;
+	file->size = 0;
+}
+
+i32 platform_file_info(const char* path, i64* mtime, u64* size) {
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesExA(path, GetFileExInfoStandard, &attributes))
+		return 1;
+	*mtime = (i64)((u64)attributes.ftLastWriteTime.dwHighDateTime << 32 | attributes.ftLastWriteTime.dwLowDateTime);
+	*size = (u64)attributes.nFileSizeHigh << 32 | attributes.nFileSizeLow;
+	return 0;
+}
+
+i32 platform_list_dir(const char* path, bool (*fn)(const char* name, void* udata), void* udata) {
+	char pattern[MAX_PATH * 2];
+	sprintf_s(pattern, sizeof(pattern), "%s\\*", path);
+	WIN32_FIND_DATAA entry;
+	HANDLE find = FindFirstFileA(pattern, &entry);
+	if (find == INVALID_HANDLE_VALUE)
+		return 1;
+	do {
+		if (!fn(entry.cFileName, udata))
+			break;
+	} while (FindNextFileA(find, &entry));
+	FindClose(find);
+	return 0;
+}
+
+i32 platform_replace_file(const char* from, const char* to) {
+	return !MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING);
+}
+
+i32 platform_steam_root(char* output, i32 output_size) {
+	DWORD size = (DWORD)output_size;
+	if (RegGetValueA(HKEY_CURRENT_USER, "Software\\Valve\\Steam", "SteamPath", RRF_RT_REG_SZ, NULL, output, &size) != ERROR_SUCCESS)
+		return 1;
+	return 0;
+}
+
+// === Misc ===
+u64 platform_monotonic_us(void) {
+	static LARGE_INTEGER freq;
+	LARGE_INTEGER now;
+	if (freq.QuadPart == 0)
+		QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&now);
+	return (u64)(now.QuadPart / freq.QuadPart) * 1000000 + (u64)(now.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart;
+}
+
+void platform_sleep_ms(u32 ms) {
+	Sleep(ms);
+}
+
+i32 platform_executable_path(char* output, i32 output_size) {
+	DWORD len = GetModuleFileNameA(NULL, output, (DWORD)output_size);
+	return len == 0 || len >= (DWORD)output_size;
+}
+
+i32 platform_temp_dir(char* output, i32 output_size) {
+	DWORD len = GetTempPathA((DWORD)output_size, output);
+	if (len == 0 || len >= (DWORD)output_size)
+		return 1;
+	if (output[len - 1] == '\\' || output[len - 1] == '/')
+		output[len - 1] = '\0';
+	return 0;
+}
+
+void platform_pause(void) {
+	system("pause");
+}
+#endif
@@ -0,0 +1,138 @@
+// === Includes ===
+#include "resource_sampler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "log.h"
+#include "platform.h"
+
+// === Globals ===
+typedef struct ResourceSamplerContext {
+	ResourceSample* samples;
+	u32 capacity;
+	u32 head;			// next slot to write
+	u32 count;
+	u64 overwritten;
+	bool started;
+	bool paused;
+	u64 origin_us;
+	u64 paused_since_us;
+	u64 paused_total_us;
+} ResourceSamplerContext;
+
+static ResourceSamplerContext sampler_ctx = { 0 };
+
+// === Lifecycle ===
+// The ring is allocated once up front; sampling itself never allocates.
+i32 resource_sampler_init(u32 capacity) {
+	resource_sampler_free();
+	if (capacity == 0)
+		return 1;
+	sampler_ctx.samples = malloc((u64)capacity * sizeof(ResourceSample));
+	if (!sampler_ctx.samples) {
+		log_error("could not allocate %u resource samples", capacity);
+		return 1;
+	}
+	sampler_ctx.capacity = capacity;
+	return 0;
+}
+
+void resource_sampler_free(void) {
+	free(sampler_ctx.samples);
+	memset(&sampler_ctx, 0, sizeof(sampler_ctx));
+}
+
+bool resource_sampler_is_enabled(void) {
+	return sampler_ctx.samples != NULL;
+}
+
+void resource_sampler_start(u64 now_us) {
+	sampler_ctx.head = 0;
+	sampler_ctx.count = 0;
+	sampler_ctx.overwritten = 0;
+	sampler_ctx.started = true;
+	sampler_ctx.paused = false;
+	sampler_ctx.origin_us = now_us;
+	sampler_ctx.paused_total_us = 0;
+}
+
+void resource_sampler_pause(u64 now_us) {
+	if (!sampler_ctx.started || sampler_ctx.paused)
+		return;
+	sampler_ctx.paused = true;
+	sampler_ctx.paused_since_us = now_us;
+}
+
+void resource_sampler_resume(u64 now_us) {
+	if (!sampler_ctx.started || !sampler_ctx.paused)
+		return;
+	sampler_ctx.paused = false;
+	sampler_ctx.paused_total_us += now_us - sampler_ctx.paused_since_us;
+}
+
+// === Sampling ===
+void resource_sampler_sample(u64 now_us) {
+	if (!sampler_ctx.samples || !sampler_ctx.started || sampler_ctx.paused)
+		return;
+
+	PlatformProcessUsage usage;
+	if (platform_process_tree_usage(&usage) || usage.processes == 0)
+		return;
+
+	ResourceSample* sample = &sampler_ctx.samples[sampler_ctx.head];
+	sample->time_us = (i64)(now_us - sampler_ctx.origin_us - sampler_ctx.paused_total_us);
+	sample->cpu_us = usage.cpu_us;
+	sample->rss_bytes = usage.rss_bytes;
+	sample->read_bytes = usage.read_bytes;
+	sample->write_bytes = usage.write_bytes;
+	sample->threads = usage.threads;
+	sample->processes = usage.processes;
+
+	sampler_ctx.head = (sampler_ctx.head + 1) % sampler_ctx.capacity;
+	if (sampler_ctx.count < sampler_ctx.capacity)
+		sampler_ctx.count++;
+	else
+		sampler_ctx.overwritten++;
+}
+
+// === Sidecar ===
+static void resource_sampler_write_u32(u8* out, u32 value) {
+	memcpy(out, &value, sizeof(value));
+}
+
+// Writes the ring oldest-first: the tail segment, then the wrapped head segment.
+i32 resource_sampler_write(const char* path, u32 interval_ms) {
+	if (!sampler_ctx.samples)
+		return 0;
+
+	FILE* fp = fopen(path, "wb");
+	if (!fp) {
+		log_error("could not open resource sidecar %s", path);
+		return 1;
+	}
+
+	u8 header[16] = { 0 };
+	memcpy(header, RESOURCE_SIDECAR_MAGIC, 6);
+	header[6] = RESOURCE_SIDECAR_VERSION;
+	resource_sampler_write_u32(header + 8, interval_ms);
+	resource_sampler_write_u32(header + 12, sampler_ctx.count);
+	fwrite(header, 1, sizeof(header), fp);
+
+	u32 first = (sampler_ctx.head + sampler_ctx.capacity - sampler_ctx.count) % sampler_ctx.capacity;
+	u32 tail = sampler_ctx.count < sampler_ctx.capacity - first ? sampler_ctx.count : sampler_ctx.capacity - first;
+	fwrite(sampler_ctx.samples + first, sizeof(ResourceSample), tail, fp);
+	fwrite(sampler_ctx.samples, sizeof(ResourceSample), sampler_ctx.count - tail, fp);
+
+	i32 err = ferror(fp) != 0;
+	if (fclose(fp) != 0)
+		err = 1;
+	if (err) {
+		log_error("could not write resource sidecar %s", path);
+		return 1;
+	}
+
+	log_info("wrote %u resource samples to %s", sampler_ctx.count, path);
+	if (sampler_ctx.overwritten)
+		log_warn("resource ring was full; the oldest %llu samples were dropped", sampler_ctx.overwritten);
+	return 0;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "types.h"
+#include <stdbool.h>
+
+// === Resource sampling ===
+// Records the game's resource usage into a fixed-size ring while recording, so
+// stutters in the video can be lined up with what the game was doing. Once the
+// ring is full the oldest samples are overwritten. Sample times are relative to
+// the moment the recording output started, taken when OBS's RecordStateChanged
+// event arrives, with paused stretches removed so they match the video timeline.
+
+// === Sidecar format ===
+// Header: "SGRRES" magic, one version byte, one reserved byte, u32 sample
+// interval in ms, u32 sample count. Followed by count ResourceSample records,
+// oldest first. All fields are in host byte order (little-endian on every
+// supported target).
+#define RESOURCE_SIDECAR_MAGIC "SGRRES"
+#define RESOURCE_SIDECAR_VERSION 1
+#define RESOURCE_SIDECAR_SUFFIX ".resources"
+
+#ifndef RESOURCE_RING_SAMPLES
+#define RESOURCE_RING_SAMPLES 36000
+#endif
+
+typedef struct ResourceSample {
+	i64 time_us;		// since output start, pauses excluded
+	u64 cpu_us;			// cumulative user + kernel time of the process tree
+	u64 rss_bytes;
+	u64 read_bytes;		// cumulative
+	u64 write_bytes;	// cumulative
+	u32 threads;
+	u32 processes;
+} ResourceSample;
+
+i32 resource_sampler_init(u32 capacity);
+
+void resource_sampler_free(void);
+
+bool resource_sampler_is_enabled(void);
+
+// Mark the recording output as started; clears earlier samples.
+void resource_sampler_start(u64 now_us);
+
+void resource_sampler_pause(u64 now_us);
+
+void resource_sampler_resume(u64 now_us);
+
+// Take one sample of the tracked process tree. Ignored while paused or before start.
+void resource_sampler_sample(u64 now_us);
+
+i32 resource_sampler_write(const char* path, u32 interval_ms);
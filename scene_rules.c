@@ -0,0 +1,437 @@
+// === Includes ===
+#include "scene_rules.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "log.h"
+#include "platform.h"
+
+// === Globals ===
+typedef enum SceneRuleKind {
+	SCENE_RULE_EXACT,
+	SCENE_RULE_PREFIX,
+	SCENE_RULE_SUFFIX,
+	SCENE_RULE_GLOB,
+} SceneRuleKind;
+
+typedef struct SceneRule {
+	const char* pattern;	// lowercased, points into the file text
+	const char* scene;
+	u32 literal_len;		// length of the literal prefix (suffix for SUFFIX rules)
+	i32 next_glob;			// next glob under the same trie node, -1 at the end
+	SceneRuleKind kind;
+} SceneRule;
+
+typedef struct SceneRuleNode {
+	u32 edge_start;			// sorted edges, filled in by the compile step
+	u32 edge_count;
+	i32 exact;
+	i32 prefix;
+	i32 suffix;
+	i32 glob_head;
+	i32 glob_tail;
+	i32 first_child;		// build-time child list, sorted by c
+	i32 next_sibling;
+	u8 c;
+} SceneRuleNode;
+
+typedef struct SceneRuleEdge {
+	u8 c;
+	u32 child;
+} SceneRuleEdge;
+
+typedef struct SceneRuleSet {
+	bool loaded;
+	char* text;
+	SceneRule* rules;
+	i32 rule_count;
+	i32 rule_capacity;
+	SceneRuleNode* nodes;
+	i32 node_count;
+	i32 node_capacity;
+	SceneRuleEdge* edges;
+	i32 forward_root;
+	i32 reverse_root;
+} SceneRuleSet;
+
+static SceneRuleSet scene_rules = { 0 };
+
+// === Trie building ===
+static i32 scene_rules_new_node(u8 c) {
+	if (scene_rules.node_count == scene_rules.node_capacity) {
+		i32 capacity = scene_rules.node_capacity ? scene_rules.node_capacity * 2 : 256;
+		SceneRuleNode* grown = realloc(scene_rules.nodes, (u64)capacity * sizeof(SceneRuleNode));
+		if (!grown)
+			return -1;
+		scene_rules.nodes = grown;
+		scene_rules.node_capacity = capacity;
+	}
+	i32 index = scene_rules.node_count++;
+	SceneRuleNode* node = &scene_rules.nodes[index];
+	memset(node, 0, sizeof(*node));
+	node->exact = node->prefix = node->suffix = -1;
+	node->glob_head = node->glob_tail = -1;
+	node->first_child = node->next_sibling = -1;
+	node->c = c;
+	return index;
+}
+
+// Find or insert the child for c, keeping siblings sorted for the compile step.
+static i32 scene_rules_child(i32 parent, u8 c) {
+	i32 prev = -1;
+	i32 child = scene_rules.nodes[parent].first_child;
+	while (child >= 0 && scene_rules.nodes[child].c < c) {
+		prev = child;
+		child = scene_rules.nodes[child].next_sibling;
+	}
+	if (child >= 0 && scene_rules.nodes[child].c == c)
+		return child;
+
+	i32 created = scene_rules_new_node(c);
+	if (created < 0)
+		return -1;
+	scene_rules.nodes[created].next_sibling = child;
+	if (prev >= 0)
+		scene_rules.nodes[prev].next_sibling = created;
+	else
+		scene_rules.nodes[parent].first_child = created;
+	return created;
+}
+
+// Walk literal (forwards, or backwards when reverse) from root, creating nodes.
+static i32 scene_rules_insert(i32 root, const char* literal, u32 len, bool reverse) {
+	i32 node = root;
+	for (u32 i = 0; i < len && node >= 0; ++i)
+		node = scene_rules_child(node, (u8)literal[reverse ? len - 1 - i : i]);
+	return node;
+}
+
+// Flatten each node's child list into a sorted run of edges.
+static bool scene_rules_compile(void) {
+	scene_rules.edges = malloc((u64)(scene_rules.node_count + 1) * sizeof(SceneRuleEdge));
+	if (!scene_rules.edges)
+		return false;
+	u32 edge_count = 0;
+	for (i32 i = 0; i < scene_rules.node_count; ++i) {
+		SceneRuleNode* node = &scene_rules.nodes[i];
+		node->edge_start = edge_count;
+		for (i32 child = node->first_child; child >= 0; child = scene_rules.nodes[child].next_sibling) {
+			scene_rules.edges[edge_count].c = scene_rules.nodes[child].c;
+			scene_rules.edges[edge_count].child = (u32)child;
+			edge_count++;
+		}
+		node->edge_count = edge_count - node->edge_start;
+	}
+	return true;
+}
+
+// === Rule parsing ===
+static char* scene_rules_trim(char* s) {
+	while (*s == ' ' || *s == '\t')
+		s++;
+	u64 len = strlen(s);
+	while (len > 0 && (s[len - 1] == ' ' || s[len - 1] == '\t' || s[len - 1] == '\r'))
+		s[--len] = '\0';
+	return s;
+}
+
+static SceneRuleKind scene_rules_classify(const char* pattern, u32* literal_len) {
+	u64 len = strlen(pattern);
+	const char* first = strpbrk(pattern, "*?");
+	if (!first) {
+		*literal_len = (u32)len;
+		return SCENE_RULE_EXACT;
+	}
+	u64 wildcards = 0;
+	for (const char* p = pattern; *p; ++p)
+		wildcards += *p == '*' || *p == '?';
+	if (wildcards == 1 && pattern[len - 1] == '*') {
+		*literal_len = (u32)len - 1;
+		return SCENE_RULE_PREFIX;
+	}
+	if (wildcards == 1 && pattern[0] == '*') {
+		*literal_len = (u32)len - 1;
+		return SCENE_RULE_SUFFIX;
+	}
+	*literal_len = (u32)(first - pattern);
+	return SCENE_RULE_GLOB;
+}
+
+// Attach a rule to its trie node. Returns false on allocation failure.
+static bool scene_rules_add(char* pattern, const char* scene, i32 line) {
+	for (char* p = pattern; *p; ++p)
+		*p = (char)tolower((u8)*p);
+
+	if (scene_rules.rule_count == scene_rules.rule_capacity) {
+		i32 capacity = scene_rules.rule_capacity ? scene_rules.rule_capacity * 2 : 256;
+		SceneRule* grown = realloc(scene_rules.rules, (u64)capacity * sizeof(SceneRule));
+		if (!grown)
+			return false;
+		scene_rules.rules = grown;
+		scene_rules.rule_capacity = capacity;
+	}
+	i32 index = scene_rules.rule_count;
+	SceneRule* rule = &scene_rules.rules[index];
+	rule->pattern = pattern;
+	rule->scene = scene;
+	rule->next_glob = -1;
+	rule->kind = scene_rules_classify(pattern, &rule->literal_len);
+
+	bool reverse = rule->kind == SCENE_RULE_SUFFIX;
+	const char* literal = reverse ? pattern + 1 : pattern;
+	i32 node = scene_rules_insert(reverse ? scene_rules.reverse_root : scene_rules.forward_root, literal, rule->literal_len, reverse);
+	if (node < 0)
+		return false;
+	SceneRuleNode* target = &scene_rules.nodes[node];
+
+	i32* slot = NULL;
+	if (rule->kind == SCENE_RULE_EXACT)
+		slot = &target->exact;
+	else if (rule->kind == SCENE_RULE_PREFIX)
+		slot = &target->prefix;
+	else if (rule->kind == SCENE_RULE_SUFFIX)
+		slot = &target->suffix;
+	if (slot && *slot >= 0) {
+		log_warn("scene rules line %d repeats pattern '%s'; keeping the earlier rule", line, pattern);
+		return true;
+	}
+	if (slot) {
+		*slot = index;
+	} else {
+		if (target->glob_tail >= 0)
+			scene_rules.rules[target->glob_tail].next_glob = index;
+		else
+			target->glob_head = index;
+		target->glob_tail = index;
+	}
+	scene_rules.rule_count++;
+	return true;
+}
+
+// === Loading ===
+i32 scene_rules_load(const char* path) {
+	scene_rules_free();
+	u64 start = platform_monotonic_us();
+
+	FILE* fp = fopen(path, "rb");
+	if (!fp) {
+		log_error("could not open scene rules %s", path);
+		return 1;
+	}
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	scene_rules.text = size >= 0 ? malloc((u64)size + 1) : NULL;
+	if (!scene_rules.text) {
+		fclose(fp);
+		return 1;
+	}
+	u64 len = fread(scene_rules.text, 1, (u64)size, fp);
+	scene_rules.text[len] = '\0';
+	fclose(fp);
+
+	scene_rules.forward_root = scene_rules_new_node(0);
+	scene_rules.reverse_root = scene_rules_new_node(0);
+	if (scene_rules.forward_root < 0 || scene_rules.reverse_root < 0)
+		goto err_free;
+
+	// Lines are split in place; rules keep pointers into the text.
+	i32 line_number = 0;
+	for (char* line = scene_rules.text; line; ) {
+		char* next = strchr(line, '\n');
+		if (next)
+			*next++ = '\0';
+		line_number++;
+
+		char* comment = strchr(line, '#');
+		if (comment)
+			*comment = '\0';
+		char* eq = strchr(line, '=');
+		char* pattern = scene_rules_trim(line);
+		if (*pattern == '\0') {
+			line = next;
+			continue;
+		}
+		if (!eq) {
+			log_warn("scene rules line %d has no '='; skipped", line_number);
+			line = next;
+			continue;
+		}
+		*eq = '\0';
+		pattern = scene_rules_trim(line);
+		char* scene = scene_rules_trim(eq + 1);
+		if (*pattern == '\0' || *scene == '\0') {
+			log_warn("scene rules line %d needs a pattern and a scene; skipped", line_number);
+		} else if (!scene_rules_add(pattern, scene, line_number)) {
+			goto err_free;
+		}
+		line = next;
+	}
+
+	if (!scene_rules_compile())
+		goto err_free;
+	scene_rules.loaded = true;
+	log_info("compiled %d scene rules into %d trie nodes in %llu us",
+			 scene_rules.rule_count, scene_rules.node_count, platform_monotonic_us() - start);
+	return 0;
+
+err_free:
+	log_error("out of memory compiling scene rules");
+	scene_rules_free();
+	return 1;
+}
+
+void scene_rules_free(void) {
+	free(scene_rules.text);
+	free(scene_rules.rules);
+	free(scene_rules.nodes);
+	free(scene_rules.edges);
+	memset(&scene_rules, 0, sizeof(scene_rules));
+}
+
+// === Matching ===
+static i32 scene_rules_step(i32 node, char c) {
+	const SceneRuleNode* n = &scene_rules.nodes[node];
+	const SceneRuleEdge* edges = scene_rules.edges + n->edge_start;
+	u8 key = (u8)tolower((u8)c);
+	u32 lo = 0, hi = n->edge_count;
+	while (lo < hi) {
+		u32 mid = (lo + hi) / 2;
+		if (edges[mid].c < key)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo < n->edge_count && edges[lo].c == key ? (i32)edges[lo].child : -1;
+}
+
+// Glob match ignoring case; capture receives what the first '*' matched.
+static bool scene_rules_glob(const char* p, const char* s, const char** capture, u64* capture_len) {
+	const char* star_p = NULL;
+	const char* star_s = NULL;
+	const char* first_star = NULL;
+	*capture = s;
+	*capture_len = 0;
+	while (*s) {
+		if (*p == '*') {
+			if (!first_star) {
+				first_star = p;
+				*capture = s;
+			}
+			star_p = p++;
+			star_s = s;
+		} else if (*p == '?' || *p == (char)tolower((u8)*s)) {
+			p++;
+			s++;
+		} else if (star_p) {
+			p = star_p + 1;
+			s = ++star_s;
+			if (star_p == first_star)
+				*capture_len = (u64)(s - *capture);
+		} else {
+			return false;
+		}
+	}
+	while (*p == '*') {
+		if (!first_star) {
+			first_star = p;
+			*capture = s;
+		}
+		p++;
+	}
+	return *p == '\0';
+}
+
+// First matching glob under node, in file order.
+static i32 scene_rules_match_globs(const SceneRuleNode* node, const char* folder, u32 depth, const char** capture, u64* capture_len) {
+	for (i32 g = node->glob_head; g >= 0; g = scene_rules.rules[g].next_glob) {
+		const SceneRule* rule = &scene_rules.rules[g];
+		if (scene_rules_glob(rule->pattern + depth, folder + depth, capture, capture_len))
+			return g;
+	}
+	return -1;
+}
+
+static void scene_rules_expand(const SceneRule* rule, const char* capture, u64 capture_len, char* scene, u64 scene_size) {
+	u64 n = 0;
+	for (const char* p = rule->scene; *p && n + 1 < scene_size; ++p) {
+		if (*p != '*') {
+			scene[n++] = *p;
+			continue;
+		}
+		for (u64 i = 0; i < capture_len && n + 1 < scene_size; ++i)
+			scene[n++] = capture[i];
+	}
+	scene[n] = '\0';
+}
+
+bool scene_rules_resolve(const char* folder, char* scene, u64 scene_size) {
+	if (!scene_rules.loaded || scene_size == 0)
+		return false;
+	u64 len = strlen(folder);
+
+	// Forward walk: exact names, prefixes and globs by their literal prefix.
+	// Deeper nodes are more specific; within a node the earlier line wins.
+	i32 best = -1, root_best = -1;
+	const char* best_capture = folder;
+	u64 best_capture_len = 0;
+	const char* root_capture = folder;
+	u64 root_capture_len = 0;
+	i32 node = scene_rules.forward_root;
+	for (u64 depth = 0; node >= 0; ++depth) {
+		const SceneRuleNode* n = &scene_rules.nodes[node];
+		if (depth == len && n->exact >= 0) {
+			scene_rules_expand(&scene_rules.rules[n->exact], folder + len, 0, scene, scene_size);
+			return true;
+		}
+		const char* capture = folder;
+		u64 capture_len = 0;
+		i32 candidate = scene_rules_match_globs(n, folder, (u32)depth, &capture, &capture_len);
+		if (n->prefix >= 0 && (candidate < 0 || n->prefix < candidate)) {
+			candidate = n->prefix;
+			capture = folder + depth;
+			capture_len = len - depth;
+		}
+		if (candidate >= 0) {
+			i32* target = depth == 0 ? &root_best : &best;
+			*target = candidate;
+			if (depth == 0) {
+				root_capture = capture;
+				root_capture_len = capture_len;
+			} else {
+				best_capture = capture;
+				best_capture_len = capture_len;
+			}
+		}
+		if (depth == len)
+			break;
+		node = scene_rules_step(node, folder[depth]);
+	}
+
+	// Reverse walk: the longest matching suffix.
+	if (best < 0) {
+		node = scene_rules.reverse_root;
+		for (u64 depth = 0; node >= 0; ++depth) {
+			const SceneRuleNode* n = &scene_rules.nodes[node];
+			if (n->suffix >= 0) {
+				best = n->suffix;
+				best_capture = folder;
+				best_capture_len = len - depth;
+			}
+			if (depth == len)
+				break;
+			node = scene_rules_step(node, folder[len - 1 - depth]);
+		}
+	}
+
+	if (best < 0) {
+		best = root_best;
+		best_capture = root_capture;
+		best_capture_len = root_capture_len;
+	}
+	if (best < 0)
+		return false;
+	scene_rules_expand(&scene_rules.rules[best], best_capture, best_capture_len, scene, scene_size);
+	return true;
+}
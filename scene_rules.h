@@ -0,0 +1,33 @@
+#pragma once
+#include "types.h"
+#include <stdbool.h>
+
+// === Scene rules ===
+// Overrides the scene a game records into, keyed on its steamapps/common
+// folder. The rules file (config key scene_rules) has one rule per line,
+// '#' starts a comment:
+//   <pattern> = <scene>
+// Patterns match the whole folder name, ignoring case:
+//   Portal 2            exact folder
+//   Portal 2*           folder prefix, e.g. "Portal 2 Beta" or "Portal 2_v1.1"
+//   *_DLC               folder suffix
+//   Game?_Test*         any other glob; '?' is one character, '*' any run
+// A '*' in the scene is replaced by the text the pattern's first '*' matched,
+// so "*_Test = *" groups "Foo_Test" into "Foo".
+//
+// Exact names win, then the rule with the longest literal prefix, then the
+// rule with the longest literal suffix; ties go to the earlier line.
+//
+// The rules compile into a prefix trie (exact, prefix, and globs under their
+// literal prefix) and a trie of reversed suffixes. Resolving a folder walks
+// each once, so the cost follows the folder length rather than the number of
+// rules. Only globs that start with '*' and are not plain suffixes are tried
+// on every lookup.
+
+// Compile the rules file. Returns 0 on success; bad lines are logged and skipped.
+i32 scene_rules_load(const char* path);
+
+void scene_rules_free(void);
+
+// Map a game folder to its scene. Returns false when no rule matched.
+bool scene_rules_resolve(const char* folder, char* scene, u64 scene_size);
@@ -0,0 +1,652 @@
+// === Includes ===
+#include "steam_library.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "log.h"
+#include "path.h"
+#include "platform.h"
+
+// === Globals ===
+typedef struct SteamIndexHeader {
+	char magic[6];
+	u8 version;
+	u8 reserved;
+	u64 fingerprint;
+	i64 folders_mtime;
+	u32 slot_count;
+	u32 entry_count;
+	u32 strings_size;
+	u32 libraries_offset;
+	u32 library_count;
+	u32 reserved2;
+} SteamIndexHeader;
+
+typedef struct SteamIndexSlot {
+	u32 hash;
+	u32 appid;
+	u32 key_offset;
+	u32 name_offset;
+} SteamIndexSlot;
+
+typedef struct SteamLibraries {
+	i32 count;
+	char paths[STEAM_MAX_LIBRARIES][1024];	// as found, for listing
+	char keys[STEAM_MAX_LIBRARIES][1024];	// normalized, no trailing '/'
+} SteamLibraries;
+
+typedef struct SteamManifest {
+	u32 appid;
+	char key[1024];
+	char name[256];
+	char install_dir[1024];		// original case, for listing and naming
+} SteamManifest;
+
+// === Hashing ===
+static u32 steam_hash32(const char* s) {
+	u32 hash = 2166136261u;
+	for (; *s; ++s)
+		hash = (hash ^ (u8)*s) * 16777619u;
+	return hash;
+}
+
+static u64 steam_hash64(u64 hash, const void* data, u64 len) {
+	const u8* p = data;
+	for (u64 i = 0; i < len; ++i)
+		hash = (hash ^ p[i]) * 1099511628211ull;
+	return hash;
+}
+
+// === VDF parsing ===
+// Valve's KeyValues text: quoted keys and values, nested braces, // comments.
+typedef void (*VdfPairFn)(const char* key, const char* value, i32 depth, void* udata);
+
+// Returns '"' for a string, '{' or '}', or 0 at the end of the text.
+static char vdf_next_token(const char** cursor, const char* end, char* out, u64 out_size) {
+	const char* p = *cursor;
+	for (;;) {
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+			p++;
+		if (p + 1 < end && p[0] == '/' && p[1] == '/') {
+			while (p < end && *p != '\n')
+				p++;
+			continue;
+		}
+		break;
+	}
+	if (p >= end) {
+		*cursor = p;
+		return 0;
+	}
+	if (*p == '{' || *p == '}') {
+		*cursor = p + 1;
+		return *p;
+	}
+
+	u64 n = 0;
+	bool quoted = *p == '"';
+	if (quoted)
+		p++;
+	while (p < end && (quoted ? *p != '"' : (*p != ' ' && *p != '\t' && *p != '\r' && *p != '\n'))) {
+		char c = *p++;
+		if (quoted && c == '\\' && p < end) {
+			c = *p++;
+			if (c == 'n')
+				c = '\n';
+			else if (c == 't')
+				c = '\t';
+		}
+		if (n + 1 < out_size)
+			out[n++] = c;
+	}
+	if (quoted && p < end)
+		p++;
+	out[n] = '\0';
+	*cursor = p;
+	return '"';
+}
+
+static void vdf_parse(const char* text, u64 len, VdfPairFn fn, void* udata) {
+	const char* cursor = text;
+	const char* end = text + len;
+	char key[256], value[1024];
+	i32 depth = 0;
+	bool has_key = false;
+	for (;;) {
+		char token = vdf_next_token(&cursor, end, has_key ? value : key, has_key ? sizeof(value) : sizeof(key));
+		if (token == 0)
+			return;
+		if (token == '{') {
+			depth++;
+			has_key = false;
+		} else if (token == '}') {
+			depth--;
+			has_key = false;
+		} else if (has_key) {
+			fn(key, value, depth, udata);
+			has_key = false;
+		} else {
+			has_key = true;
+		}
+	}
+}
+
+static char* steam_read_file(const char* path, u64* len) {
+	FILE* fp = fopen(path, "rb");
+	if (!fp)
+		return NULL;
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	char* data = size >= 0 ? malloc((u64)size + 1) : NULL;
+	if (data) {
+		*len = fread(data, 1, (u64)size, fp);
+		data[*len] = '\0';
+	}
+	fclose(fp);
+	return data;
+}
+
+// === Library discovery ===
+static void steam_add_library(SteamLibraries* libs, const char* path) {
+	char norm[1024];
+	u64 len = path_normalize(path, norm, sizeof(norm));
+	while (len > 1 && norm[len - 1] == '/')
+		norm[--len] = '\0';
+	if (len == 0)
+		return;
+	for (i32 i = 0; i < libs->count; ++i) {
+		if (strcmp(libs->keys[i], norm) == 0)
+			return;
+	}
+	if (libs->count == STEAM_MAX_LIBRARIES) {
+		log_warn("more than %d Steam libraries; ignoring %s", STEAM_MAX_LIBRARIES, path);
+		return;
+	}
+	strncpy_s(libs->paths[libs->count], sizeof(libs->paths[0]), path, len);
+	strcpy_s(libs->keys[libs->count], sizeof(libs->keys[0]), norm);
+	libs->count++;
+}
+
+// Current files list each library as "path" inside a numbered block; old ones
+// used the number itself as the key.
+static void steam_library_folders_pair(const char* key, const char* value, i32 depth, void* udata) {
+	bool numbered = key[0] >= '0' && key[0] <= '9';
+	if ((depth == 2 && strcmp(key, "path") == 0) || (depth == 1 && numbered))
+		steam_add_library(udata, value);
+}
+
+static i32 steam_find_root(char* root, u64 root_size) {
+	const char* configured = config_get_str("steam_root", NULL);
+	if (configured && *configured)
+		return snprintf(root, root_size, "%s", configured) >= (i32)root_size;
+	return platform_steam_root(root, (i32)root_size);
+}
+
+static void steam_folders_path(const char* root, char* path, u64 path_size) {
+	snprintf(path, path_size, "%s/steamapps/libraryfolders.vdf", root);
+}
+
+// Last write time of libraryfolders.vdf, -1 when there is none.
+static i64 steam_folders_mtime(const char* root) {
+	if (!*root)
+		return -1;
+	char vdf_path[1200];
+	steam_folders_path(root, vdf_path, sizeof(vdf_path));
+	i64 mtime;
+	u64 size;
+	return platform_file_info(vdf_path, &mtime, &size) == 0 ? mtime : -1;
+}
+
+// Parse libraryfolders.vdf; the root itself is a library as well.
+static void steam_read_library_folders(const char* root, SteamLibraries* libs) {
+	if (!*root)
+		return;
+	char vdf_path[1200];
+	steam_folders_path(root, vdf_path, sizeof(vdf_path));
+	u64 len;
+	char* text = steam_read_file(vdf_path, &len);
+	if (text) {
+		vdf_parse(text, len, steam_library_folders_pair, libs);
+		free(text);
+	}
+	steam_add_library(libs, root);
+}
+
+// The library holding the game counts even when libraryfolders.vdf is missing.
+static void steam_add_own_library(SteamLibraries* libs, const char* install_dir) {
+	char common[1024], steamapps[1024], own[1024];
+	if (*install_dir &&
+		extract_parent_folder(install_dir, common, sizeof(common)) == 0 &&
+		extract_parent_folder(common, steamapps, sizeof(steamapps)) == 0 &&
+		extract_parent_folder(steamapps, own, sizeof(own)) == 0)
+		steam_add_library(libs, own);
+}
+
+// Installing or removing a game adds or removes its manifest in steamapps and
+// its folder in steamapps/common, which shows in those directories' write
+// times, so two stats per library stand in for statting every manifest.
+// Libraries are summed, so the order they were found in does not matter.
+static u64 steam_libraries_fingerprint(const char* root, i64 folders_mtime, const SteamLibraries* libs) {
+	u64 fingerprint = steam_hash64(14695981039346656037ull, root, strlen(root));
+	fingerprint = steam_hash64(fingerprint, &folders_mtime, sizeof(folders_mtime));
+	u64 sum = 0;
+	for (i32 i = 0; i < libs->count; ++i) {
+		u64 library = steam_hash64(14695981039346656037ull, libs->keys[i], strlen(libs->keys[i]));
+		static const char* dirs[] = { "steamapps", "steamapps/common" };
+		for (u64 d = 0; d < sizeof(dirs) / sizeof(dirs[0]); ++d) {
+			char dir[1200];
+			snprintf(dir, sizeof(dir), "%s/%s", libs->paths[i], dirs[d]);
+			i64 mtime;
+			u64 size;
+			if (platform_file_info(dir, &mtime, &size) != 0)
+				mtime = -1;
+			library = steam_hash64(library, &mtime, sizeof(mtime));
+		}
+		sum += library;
+	}
+	return steam_hash64(fingerprint, &sum, sizeof(sum));
+}
+
+// === Manifests ===
+typedef struct SteamManifestScan {
+	const char* library;
+	SteamManifest* manifests;
+	i32 count;
+	i32 capacity;
+} SteamManifestScan;
+
+static bool steam_is_manifest_name(const char* name) {
+	u64 len = strlen(name);
+	return strncmp(name, "appmanifest_", 12) == 0 && len > 16 && strcmp(name + len - 4, ".acf") == 0;
+}
+
+typedef struct SteamManifestFields {
+	u32 appid;
+	char name[256];
+	char install_dir[256];
+} SteamManifestFields;
+
+static void steam_manifest_pair(const char* key, const char* value, i32 depth, void* udata) {
+	SteamManifestFields* fields = udata;
+	if (depth != 1)
+		return;
+	if (strcmp(key, "appid") == 0)
+		fields->appid = (u32)strtoul(value, NULL, 10);
+	else if (strcmp(key, "name") == 0)
+		strcpy_s(fields->name, sizeof(fields->name), value);
+	else if (strcmp(key, "installdir") == 0)
+		strcpy_s(fields->install_dir, sizeof(fields->install_dir), value);
+}
+
+static void steam_load_manifest(SteamManifestScan* scan, const char* path) {
+	u64 len;
+	char* text = steam_read_file(path, &len);
+	if (!text)
+		return;
+	SteamManifestFields fields = { 0 };
+	vdf_parse(text, len, steam_manifest_pair, &fields);
+	free(text);
+	if (!fields.appid || !fields.install_dir[0])
+		return;
+
+	if (scan->count == scan->capacity) {
+		i32 capacity = scan->capacity ? scan->capacity * 2 : 256;
+		SteamManifest* grown = realloc(scan->manifests, (u64)capacity * sizeof(SteamManifest));
+		if (!grown)
+			return;
+		scan->manifests = grown;
+		scan->capacity = capacity;
+	}
+	SteamManifest* manifest = &scan->manifests[scan->count++];
+	manifest->appid = fields.appid;
+	strcpy_s(manifest->name, sizeof(manifest->name), fields.name[0] ? fields.name : fields.install_dir);
+	snprintf(manifest->install_dir, sizeof(manifest->install_dir), "%s/steamapps/common/%s", scan->library, fields.install_dir);
+	path_normalize(manifest->install_dir, manifest->key, sizeof(manifest->key));
+}
+
+static bool steam_scan_entry(const char* name, void* udata) {
+	SteamManifestScan* scan = udata;
+	if (!steam_is_manifest_name(name))
+		return true;
+	char path[1200];
+	snprintf(path, sizeof(path), "%s/steamapps/%s", scan->library, name);
+	steam_load_manifest(scan, path);
+	return true;
+}
+
+// Parse every manifest of every library into scan->manifests.
+static void steam_scan_libraries(const SteamLibraries* libs, SteamManifestScan* scan) {
+	scan->manifests = NULL;
+	scan->count = 0;
+	scan->capacity = 0;
+	for (i32 i = 0; i < libs->count; ++i) {
+		char steamapps[1200];
+		snprintf(steamapps, sizeof(steamapps), "%s/steamapps", libs->paths[i]);
+		scan->library = libs->paths[i];
+		platform_list_dir(steamapps, steam_scan_entry, scan);
+	}
+}
+
+// === Index ===
+// Entries store three strings back to back: the normalized key, the store name
+// and the install folder as found on disk.
+static void steam_index_entry(const char* strings, const SteamIndexSlot* slot, SteamGameInfo* info) {
+	const char* name = strings + slot->name_offset;
+	info->appid = slot->appid;
+	strcpy_s(info->name, sizeof(info->name), name);
+	strcpy_s(info->install_dir, sizeof(info->install_dir), name + strlen(name) + 1);
+}
+
+// Probe a mapped or freshly built index. Returns false when the key is absent.
+static bool steam_index_find(const u8* data, u64 size, const char* key, SteamGameInfo* info) {
+	if (size < sizeof(SteamIndexHeader))
+		return false;
+	const SteamIndexHeader* header = (const SteamIndexHeader*)data;
+	const SteamIndexSlot* slots = (const SteamIndexSlot*)(data + sizeof(SteamIndexHeader));
+	const char* strings = (const char*)(slots + header->slot_count);
+	u32 hash = steam_hash32(key);
+	u32 mask = header->slot_count - 1;
+	for (u32 i = hash & mask, n = 0; n < header->slot_count; i = (i + 1) & mask, ++n) {
+		const SteamIndexSlot* slot = &slots[i];
+		if (slot->key_offset == 0)
+			return false;
+		if (slot->hash == hash && strcmp(strings + slot->key_offset, key) == 0) {
+			steam_index_entry(strings, slot, info);
+			return true;
+		}
+	}
+	return false;
+}
+
+// Returns the offset just past the string at offset, or 0 if it does not
+// start inside the string table. The table ends in '\0', so a string that
+// starts inside it also ends inside it.
+static u32 steam_index_skip(const char* strings, u32 strings_size, u32 offset) {
+	if (offset == 0 || offset >= strings_size)
+		return 0;
+	return offset + (u32)strlen(strings + offset) + 1;
+}
+
+// Checks that the header, slots and string table all fit and are terminated,
+// and that every string offset points into the table, so lookups can trust
+// the file. The fingerprint is compared separately.
+static bool steam_index_valid(const u8* data, u64 size) {
+	if (size < sizeof(SteamIndexHeader))
+		return false;
+	const SteamIndexHeader* header = (const SteamIndexHeader*)data;
+	if (memcmp(header->magic, STEAM_INDEX_MAGIC, 6) != 0 || header->version != STEAM_INDEX_VERSION)
+		return false;
+	if (header->slot_count == 0 || (header->slot_count & (header->slot_count - 1)) != 0)
+		return false;
+	u64 expected = sizeof(SteamIndexHeader) + (u64)header->slot_count * sizeof(SteamIndexSlot) + header->strings_size;
+	if (expected != size || header->strings_size == 0 || data[size - 1] != '\0')
+		return false;
+
+	const SteamIndexSlot* slots = (const SteamIndexSlot*)(data + sizeof(SteamIndexHeader));
+	const char* strings = (const char*)(slots + header->slot_count);
+	u32 strings_size = header->strings_size;
+	for (u32 i = 0; i < header->slot_count; ++i) {
+		if (slots[i].key_offset == 0)
+			continue;
+		// The install folder follows the name.
+		u32 dir_offset = steam_index_skip(strings, strings_size, slots[i].name_offset);
+		if (!steam_index_skip(strings, strings_size, slots[i].key_offset) || !steam_index_skip(strings, strings_size, dir_offset))
+			return false;
+	}
+	// The Steam root, then each library.
+	u32 offset = header->libraries_offset;
+	for (u32 i = 0; i <= header->library_count; ++i) {
+		offset = steam_index_skip(strings, strings_size, offset);
+		if (!offset)
+			return false;
+	}
+	return true;
+}
+
+// Reuse the library list saved in the index while libraryfolders.vdf is
+// unchanged. Returns false when it has to be parsed again.
+static bool steam_index_libraries(const u8* data, const char* root, i64 folders_mtime, SteamLibraries* libs) {
+	const SteamIndexHeader* header = (const SteamIndexHeader*)data;
+	if (header->folders_mtime != folders_mtime)
+		return false;
+	const char* strings = (const char*)(data + sizeof(SteamIndexHeader) + (u64)header->slot_count * sizeof(SteamIndexSlot));
+	const char* library = strings + header->libraries_offset;
+	if (strcmp(library, root) != 0)
+		return false;
+	for (u32 i = 0; i < header->library_count; ++i) {
+		library += strlen(library) + 1;
+		steam_add_library(libs, library);
+	}
+	return true;
+}
+
+static u8* steam_index_build(const SteamManifest* manifests, i32 count, const char* root, i64 folders_mtime, const SteamLibraries* libs, u64 fingerprint, u64* size) {
+	u32 slot_count = 16;
+	while (slot_count < (u32)count * 2)
+		slot_count <<= 1;
+	u64 strings_size = 1;	// offset 0 is the empty-slot marker
+	for (i32 i = 0; i < count; ++i)
+		strings_size += strlen(manifests[i].key) + 1 + strlen(manifests[i].name) + 1 + strlen(manifests[i].install_dir) + 1;
+	strings_size += strlen(root) + 1;
+	for (i32 i = 0; i < libs->count; ++i)
+		strings_size += strlen(libs->paths[i]) + 1;
+
+	*size = sizeof(SteamIndexHeader) + (u64)slot_count * sizeof(SteamIndexSlot) + strings_size;
+	u8* data = calloc(1, *size);
+	if (!data)
+		return NULL;
+
+	SteamIndexHeader* header = (SteamIndexHeader*)data;
+	memcpy(header->magic, STEAM_INDEX_MAGIC, 6);
+	header->version = STEAM_INDEX_VERSION;
+	header->fingerprint = fingerprint;
+	header->folders_mtime = folders_mtime;
+	header->slot_count = slot_count;
+	header->strings_size = (u32)strings_size;
+	SteamIndexSlot* slots = (SteamIndexSlot*)(data + sizeof(SteamIndexHeader));
+	char* strings = (char*)(slots + slot_count);
+
+	u32 offset = 1;
+	for (i32 i = 0; i < count; ++i) {
+		u32 hash = steam_hash32(manifests[i].key);
+		u32 slot = hash & (slot_count - 1);
+		bool duplicate = false;
+		while (slots[slot].key_offset != 0) {
+			if (slots[slot].hash == hash && strcmp(strings + slots[slot].key_offset, manifests[i].key) == 0) {
+				duplicate = true;	// the same folder listed by two libraries
+				break;
+			}
+			slot = (slot + 1) & (slot_count - 1);
+		}
+		if (duplicate)
+			continue;
+		slots[slot].hash = hash;
+		slots[slot].appid = manifests[i].appid;
+		slots[slot].key_offset = offset;
+		u64 key_len = strlen(manifests[i].key) + 1;
+		memcpy(strings + offset, manifests[i].key, key_len);
+		offset += (u32)key_len;
+		slots[slot].name_offset = offset;
+		u64 name_len = strlen(manifests[i].name) + 1;
+		memcpy(strings + offset, manifests[i].name, name_len);
+		offset += (u32)name_len;
+		u64 dir_len = strlen(manifests[i].install_dir) + 1;
+		memcpy(strings + offset, manifests[i].install_dir, dir_len);
+		offset += (u32)dir_len;
+		header->entry_count++;
+	}
+
+	header->libraries_offset = offset;
+	header->library_count = (u32)libs->count;
+	u64 root_len = strlen(root) + 1;
+	memcpy(strings + offset, root, root_len);
+	offset += (u32)root_len;
+	for (i32 i = 0; i < libs->count; ++i) {
+		u64 path_len = strlen(libs->paths[i]) + 1;
+		memcpy(strings + offset, libs->paths[i], path_len);
+		offset += (u32)path_len;
+	}
+	return data;
+}
+
+// Written to a unique temporary name and moved into place, so concurrent
+// sessions only ever map a complete file.
+static void steam_index_save(const char* path, const u8* data, u64 size) {
+	u64 tmp_size = strlen(path) + 32;
+	char* tmp_path = malloc(tmp_size);
+	if (!tmp_path)
+		return;
+	snprintf(tmp_path, tmp_size, "%s.%llx.tmp", path, platform_monotonic_us());
+	FILE* fp = fopen(tmp_path, "wb");
+	if (!fp) {
+		log_warn("could not write Steam library index %s", tmp_path);
+		free(tmp_path);
+		return;
+	}
+	bool ok = fwrite(data, 1, size, fp) == size;
+	ok = fclose(fp) == 0 && ok;
+	if (!ok || platform_replace_file(tmp_path, path) != 0) {
+		log_warn("could not save Steam library index %s", path);
+		remove(tmp_path);
+	}
+	free(tmp_path);
+}
+
+static i32 steam_index_path(char* path, u64 path_size) {
+	const char* configured = config_get_str("steam_index_path", NULL);
+	if (configured && *configured)
+		return snprintf(path, path_size, "%s", configured) >= (i32)path_size;
+	char dir[1024];
+	if (platform_temp_dir(dir, sizeof(dir)))
+		return 1;
+	return snprintf(path, path_size, "%s/%s", dir, STEAM_INDEX_FILE_NAME) >= (i32)path_size;
+}
+
+// === Lookup ===
+// With rebuild set, the index on disk is replaced even if it looks current.
+static i32 steam_index_open(const char* path, bool rebuild, SteamLibraryIndex* index) {
+	index->mapped.data = NULL;
+	index->mapped.size = 0;
+	index->built = NULL;
+	index->data = NULL;
+	index->size = 0;
+
+	char install_dir[1024] = "";
+	if (path && extract_steam_install_dir(path, install_dir, sizeof(install_dir)))
+		return 1;
+
+	char index_path[1200];
+	if (steam_index_path(index_path, sizeof(index_path)))
+		return 1;
+
+	char root[1024];
+	if (steam_find_root(root, sizeof(root)))
+		root[0] = '\0';
+	i64 folders_mtime = steam_folders_mtime(root);
+
+	bool mapped = false;
+	if (!rebuild && platform_map_file(index_path, &index->mapped) == 0) {
+		mapped = steam_index_valid(index->mapped.data, index->mapped.size);
+		if (!mapped)
+			platform_unmap_file(&index->mapped);
+	}
+
+	// Libraries the index was built with stay in it until libraryfolders.vdf
+	// changes, so launching from a library it does not list and listing the
+	// whole library agree on the set.
+	SteamLibraries libs;
+	libs.count = 0;
+	if (!mapped || !steam_index_libraries(index->mapped.data, root, folders_mtime, &libs))
+		steam_read_library_folders(root, &libs);
+	steam_add_own_library(&libs, install_dir);
+	if (libs.count == 0) {
+		if (mapped)
+			platform_unmap_file(&index->mapped);
+		return 1;
+	}
+
+	u64 fingerprint = steam_libraries_fingerprint(root, folders_mtime, &libs);
+	if (mapped) {
+		if (((const SteamIndexHeader*)index->mapped.data)->fingerprint == fingerprint) {
+			index->data = index->mapped.data;
+			index->size = index->mapped.size;
+			return 0;
+		}
+		platform_unmap_file(&index->mapped);
+	}
+
+	u64 start = platform_monotonic_us();
+	SteamManifestScan scan;
+	steam_scan_libraries(&libs, &scan);
+	u64 size;
+	u8* data = steam_index_build(scan.manifests, scan.count, root, folders_mtime, &libs, fingerprint, &size);
+	free(scan.manifests);
+	if (!data)
+		return 1;
+	steam_index_save(index_path, data, size);
+	log_info("indexed %d Steam manifests across %d libraries in %llu us", scan.count, libs.count, platform_monotonic_us() - start);
+
+	index->built = data;
+	index->data = data;
+	index->size = size;
+	return 0;
+}
+
+i32 steam_library_open(const char* path, SteamLibraryIndex* index) {
+	return steam_index_open(path, false, index);
+}
+
+void steam_library_close(SteamLibraryIndex* index) {
+	if (index->mapped.data)
+		platform_unmap_file(&index->mapped);
+	free(index->built);
+	index->built = NULL;
+	index->data = NULL;
+	index->size = 0;
+}
+
+i32 steam_library_find(const SteamLibraryIndex* index, const char* path, SteamGameInfo* info) {
+	char install_dir[1024], key[1024];
+	if (extract_steam_install_dir(path, install_dir, sizeof(install_dir)))
+		return 1;
+	path_normalize(install_dir, key, sizeof(key));
+	return steam_index_find(index->data, index->size, key, info) ? 0 : 1;
+}
+
+i32 steam_library_for_each(const SteamLibraryIndex* index, bool (*fn)(const SteamGameInfo* info, void* udata), void* udata) {
+	if (index->size < sizeof(SteamIndexHeader))
+		return 0;
+	const SteamIndexHeader* header = (const SteamIndexHeader*)index->data;
+	const SteamIndexSlot* slots = (const SteamIndexSlot*)(index->data + sizeof(SteamIndexHeader));
+	const char* strings = (const char*)(slots + header->slot_count);
+	i32 visited = 0;
+	for (u32 i = 0; i < header->slot_count; ++i) {
+		if (slots[i].key_offset == 0)
+			continue;
+		SteamGameInfo info;
+		steam_index_entry(strings, &slots[i], &info);
+		visited++;
+		if (!fn(&info, udata))
+			break;
+	}
+	return visited;
+}
+
+i32 steam_library_lookup(const char* path, SteamGameInfo* info) {
+	SteamLibraryIndex index;
+	if (steam_library_open(path, &index))
+		return 1;
+	i32 err = steam_library_find(&index, path, info);
+	bool mapped = index.mapped.data != NULL;
+	steam_library_close(&index);
+	// The directory times miss a manifest rewritten in place, e.g. a game
+	// moved to another folder name; a game missing from an old index gets
+	// one rebuild before giving up.
+	if (err && mapped && steam_index_open(path, true, &index) == 0) {
+		err = steam_library_find(&index, path, info);
+		steam_library_close(&index);
+	}
+	return err;
+}
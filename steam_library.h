@@ -0,0 +1,63 @@
+#pragma once
+#include "platform.h"
+#include "types.h"
+#include <stdbool.h>
+
+// === Steam library index ===
+// Maps a game's install folder (<library>/steamapps/common/<installdir>) to its
+// appid and store name. The index is built from libraryfolders.vdf and every
+// appmanifest_*.acf, saved as a memory-mapped hash file and rebuilt only when
+// libraryfolders.vdf or a library's steamapps or steamapps/common folder
+// changes. The library list is kept in the index as well, so a launch costs a
+// few stats and one probe instead of parsing VDF text.
+
+// === Index format ===
+// Header (48 bytes): "SGRLIB" magic, version byte, reserved byte, u64
+// fingerprint, i64 libraryfolders.vdf write time, u32 slot count (power of
+// two), u32 entry count, u32 string table size, u32 library list offset, u32
+// library count, u32 reserved. Then the slots, then the string table. A slot
+// is { u32 hash, u32 appid, u32 key offset, u32 name offset }; key offset 0
+// marks an empty slot. Keys are install folders with '/' separators,
+// lowercased. The install folder as found on disk follows the name in the
+// string table. The library list is the Steam root followed by each library,
+// as found. Fields are in host byte order.
+#define STEAM_INDEX_MAGIC "SGRLIB"
+#define STEAM_INDEX_VERSION 3
+
+#ifndef STEAM_INDEX_FILE_NAME
+#define STEAM_INDEX_FILE_NAME "smart_grecording-steam.idx"
+#endif
+
+#ifndef STEAM_MAX_LIBRARIES
+#define STEAM_MAX_LIBRARIES 32
+#endif
+
+typedef struct SteamGameInfo {
+	u32 appid;
+	char name[256];
+	char install_dir[1024];		// <library>/steamapps/common/<installdir>, original case
+} SteamGameInfo;
+
+// An index that is either mapped from disk or was just rebuilt in memory.
+typedef struct SteamLibraryIndex {
+	PlatformMappedFile mapped;
+	u8* built;
+	const u8* data;
+	u64 size;
+} SteamLibraryIndex;
+
+// Map the index, rebuilding it first if the manifests changed. path may be any
+// file inside an installed game, whose own library is then included, or NULL
+// to use only the Steam root and its libraryfolders.vdf.
+i32 steam_library_open(const char* path, SteamLibraryIndex* index);
+
+void steam_library_close(SteamLibraryIndex* index);
+
+// Find the installed game that contains path. Returns 0 when found.
+i32 steam_library_find(const SteamLibraryIndex* index, const char* path, SteamGameInfo* info);
+
+// Call fn for every indexed game until it returns false. Returns the number visited.
+i32 steam_library_for_each(const SteamLibraryIndex* index, bool (*fn)(const SteamGameInfo* info, void* udata), void* udata);
+
+// Open, find and close in one call.
+i32 steam_library_lookup(const char* path, SteamGameInfo* info);
@@ -0,0 +1,120 @@
+// Drives the session loop against a child that sleeps, and checks that the
+// loop waits on the exit instead of spinning: the number of wakeups must stay
+// within what the tick interval and the exit watcher's fallback slice allow.
+// The test binary is its own child: run with --sleep MS it just sleeps.
+
+// === Includes ===
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "game_launcher.h"
+#include "log.h"
+#include "platform.h"
+
+// === Child ===
+#define CHILD_SLEEP_MS 1000
+
+// Wakeups allowed beyond the expected ones: the first pass, the exit and a
+// spurious return or two from the poll.
+#define SLACK_WAKEUPS 4
+
+// Longest fallback slice that still counts as watching the exit.
+#define MAX_FALLBACK_MS 1000
+
+static i32 run_child(const char* ms) {
+	platform_sleep_ms((u32)atoi(ms));
+	return 0;
+}
+
+// === Session ===
+typedef struct SessionCounts {
+	i32 detected;
+	i32 ticks;
+	i32 fallback_ms;	// poll interval while the game is tracked
+} SessionCounts;
+
+static void count_detected(i64 pid, void* udata) {
+	(void)pid;
+	SessionCounts* counts = (SessionCounts*)udata;
+	counts->detected++;
+	// Read it here: once the tree drains there is nothing left to poll.
+	counts->fallback_ms = platform_process_tree_poll_interval_ms();
+}
+
+static void count_tick(void* udata) {
+	((SessionCounts*)udata)->ticks++;
+}
+
+// Run one session against a sleeping child; with tick_ms set the loop also
+// wakes for on_tick. Returns the number of failed checks.
+static i32 run_session(const char* self, u32 tick_ms) {
+	struct mg_mgr mgr;
+	mg_mgr_init(&mgr);
+	SessionCounts counts = { 0, 0, 0 };
+	u64 wakeups = 0;
+	GameSessionHooks hooks = { count_detected, tick_ms ? count_tick : NULL, tick_ms, &counts, &mgr, &wakeups };
+	PlacementPolicy placement;
+	memset(&placement, 0, sizeof(placement));
+
+	char sleep_ms[16];
+	snprintf(sleep_ms, sizeof(sleep_ms), "%d", CHILD_SLEEP_MS);
+	char* argv[] = { "test_game_session", (char*)self, "--sleep", sleep_ms, NULL };
+	u64 start = platform_monotonic_us();
+	i32 err = launch_target_game(4, argv, &placement, &hooks);
+	u64 elapsed_ms = (platform_monotonic_us() - start) / 1000;
+	i32 fallback_ms = counts.fallback_ms;
+	mg_mgr_free(&mgr);
+
+	// Each source of wakeups contributes at most one per interval.
+	u64 limit = SLACK_WAKEUPS;
+	if (tick_ms)
+		limit += elapsed_ms / tick_ms;
+	if (fallback_ms > 0)
+		limit += elapsed_ms / (u64)fallback_ms;
+
+	i32 failed = 0;
+	printf("tick %u ms: err %d, %llu ms, %llu wakeups (limit %llu), fallback %d ms, %d ticks\n",
+		   tick_ms, err, elapsed_ms, wakeups, limit, fallback_ms, counts.ticks);
+	if (err) {
+		printf("FAIL: launch_target_game returned %d\n", err);
+		failed++;
+	}
+	if (elapsed_ms < CHILD_SLEEP_MS) {
+		printf("FAIL: session ended after %llu ms, before the child exited\n", elapsed_ms);
+		failed++;
+	}
+	if (counts.detected != 1) {
+		printf("FAIL: on_game_detected ran %d times\n", counts.detected);
+		failed++;
+	}
+	if (fallback_ms != -1 && (fallback_ms <= 0 || fallback_ms > MAX_FALLBACK_MS)) {
+		printf("FAIL: poll interval %d ms while the game ran, want -1 or 1..%d\n", fallback_ms, MAX_FALLBACK_MS);
+		failed++;
+	}
+	if (wakeups > limit) {
+		printf("FAIL: session loop woke %llu times, more than %llu\n", wakeups, limit);
+		failed++;
+	}
+	if (tick_ms && (u64)counts.ticks + 2 < elapsed_ms / tick_ms) {
+		printf("FAIL: only %d ticks in %llu ms\n", counts.ticks, elapsed_ms);
+		failed++;
+	}
+	return failed;
+}
+
+// === Main ===
+int main(int argc, char* argv[]) {
+	if (argc == 3 && strcmp(argv[1], "--sleep") == 0)
+		return run_child(argv[2]);
+
+	log_set_level(LOG_WARN);
+	mg_log_set(MG_LL_ERROR);
+	char self[1024];
+	if (platform_executable_path(self, sizeof(self))) {
+		printf("FAIL: could not find the test executable\n");
+		return 1;
+	}
+	i32 failed = run_session(self, 0);
+	failed += run_session(self, 100);
+	return failed ? 1 : 0;
+}
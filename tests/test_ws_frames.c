@@ -0,0 +1,266 @@
+// Feeds mg_ws_cb hand-built server frames and checks what it delivers: many
+// frames in one read and the same stream a byte at a time (handled frames are
+// removed once per read, behind a cursor), fragmented messages with control
+// frames between the fragments, the
+// per-connection max_recv limit, a continuation without a first frame, and
+// that buffers grown for an outsized message are given back. mg_ws_cb is
+// static, so mongoose.c is compiled into the test.
+
+// === Includes ===
+#include "mongoose.c"
+
+// === Harness ===
+#define MAX_MESSAGES 4096
+
+typedef struct Delivered {
+	size_t count;
+	uint8_t flags[MAX_MESSAGES];
+	struct mg_str data[MAX_MESSAGES];	// copies, freed by delivered_reset
+} Delivered;
+
+static Delivered delivered;
+static int failures;
+
+#define CHECK(cond, ...)                 \
+	do {                                 \
+		if (!(cond)) {                   \
+			printf("FAIL: " __VA_ARGS__); \
+			printf("\n");                \
+			failures++;                  \
+		}                                \
+	} while (0)
+
+static void delivered_reset(void) {
+	for (size_t i = 0; i < delivered.count && i < MAX_MESSAGES; ++i)
+		free((void*)delivered.data[i].buf);
+	delivered.count = 0;
+}
+
+static void on_event(struct mg_connection* c, int ev, void* ev_data) {
+	(void)c;
+	if (ev != MG_EV_WS_MSG)
+		return;
+	struct mg_ws_message* wm = ev_data;
+	if (delivered.count < MAX_MESSAGES) {
+		char* copy = malloc(wm->data.len + 1);
+		if (wm->data.len > 0)
+			memcpy(copy, wm->data.buf, wm->data.len);
+		delivered.flags[delivered.count] = wm->flags;
+		delivered.data[delivered.count] = mg_str_n(copy, wm->data.len);
+	}
+	delivered.count++;
+}
+
+// A bare client-side websocket connection: no socket, frames arrive by hand.
+static struct mg_connection* new_conn(struct mg_mgr* mgr, size_t max_recv) {
+	struct mg_connection* c = calloc(1, sizeof(*c));
+	c->mgr = mgr;
+	c->fn = on_event;
+	c->pfn = mg_ws_cb;
+	c->is_websocket = 1;
+	c->recv.align = c->send.align = c->wsmsg.align = MG_IO_SIZE;
+	c->max_recv = max_recv;
+	delivered_reset();
+	return c;
+}
+
+static void free_conn(struct mg_connection* c) {
+	mg_iobuf_free(&c->recv);
+	mg_iobuf_free(&c->send);
+	mg_iobuf_free(&c->wsmsg);
+	free(c);
+	delivered_reset();
+}
+
+// Append one unmasked frame, as a server sends it. fin 0 leaves the FIN bit clear.
+static void add_frame(struct mg_iobuf* io, int op, int fin, const void* data, size_t len) {
+	uint8_t header[14];
+	size_t header_len = mkhdr(len, op, false, header);
+	if (!fin)
+		header[0] &= 0x7f;
+	mg_iobuf_add(io, io->len, header, header_len);
+	mg_iobuf_add(io, io->len, data, len);
+}
+
+// Hand the connection bytes as one read.
+static void feed(struct mg_connection* c, const void* data, size_t len) {
+	mg_iobuf_add(&c->recv, c->recv.len, data, len);
+	mg_ws_cb(c, MG_EV_READ, NULL);
+}
+
+static bool delivered_is(size_t index, int op, const char* text) {
+	return index < delivered.count && (delivered.flags[index] & 15) == op &&
+		   mg_strcmp(delivered.data[index], mg_str(text)) == 0;
+}
+
+// === Read cursor ===
+#define STREAM_MESSAGES 2000
+
+// STREAM_MESSAGES numbered text frames, with a fragmented message and a PING
+// in the middle so the cursor meets reassembly too.
+static void build_stream(struct mg_iobuf* stream) {
+	for (int i = 0; i < STREAM_MESSAGES; ++i) {
+		char text[32];
+		int len = snprintf(text, sizeof(text), "message %04d", i);
+		if (i == STREAM_MESSAGES / 2) {
+			add_frame(stream, WEBSOCKET_OP_TEXT, 0, text, 8);
+			add_frame(stream, WEBSOCKET_OP_PING, 1, "", 0);
+			add_frame(stream, WEBSOCKET_OP_CONTINUE, 1, text + 8, (size_t)len - 8);
+		} else {
+			add_frame(stream, WEBSOCKET_OP_TEXT, 1, text, (size_t)len);
+		}
+	}
+}
+
+static void check_stream_delivered(const char* how, struct mg_connection* c) {
+	CHECK(delivered.count == STREAM_MESSAGES, "%s: %zu messages, expected %d", how, delivered.count, STREAM_MESSAGES);
+	for (int i = 0; i < STREAM_MESSAGES; ++i) {
+		char text[32];
+		snprintf(text, sizeof(text), "message %04d", i);
+		if (!delivered_is((size_t)i, WEBSOCKET_OP_TEXT, text)) {
+			CHECK(false, "%s: message %d missing or damaged", how, i);
+			break;
+		}
+	}
+	CHECK(c->recv.len == 0, "%s: %zu bytes left in recv", how, c->recv.len);
+	CHECK(!c->is_closing, "%s: connection closed", how);
+}
+
+// The same stream in one read, a byte per read, and in odd-sized pieces: each
+// frame must come out exactly once and intact however the reads split it.
+static void test_read_cursor(void) {
+	struct mg_iobuf stream = { NULL, 0, 0, 4096 };
+	build_stream(&stream);
+	static const size_t piece_sizes[] = { 0, 1, 7 };	// 0: all at once
+	for (size_t p = 0; p < sizeof(piece_sizes) / sizeof(piece_sizes[0]); ++p) {
+		struct mg_mgr mgr;
+		mg_mgr_init(&mgr);
+		struct mg_connection* c = new_conn(&mgr, MG_MAX_RECV_SIZE);
+		size_t piece = piece_sizes[p] ? piece_sizes[p] : stream.len;
+		for (size_t ofs = 0; ofs < stream.len; ofs += piece)
+			feed(c, stream.buf + ofs, stream.len - ofs < piece ? stream.len - ofs : piece);
+		char how[32];
+		snprintf(how, sizeof(how), "%zu-byte reads", piece);
+		check_stream_delivered(how, c);
+		free_conn(c);
+		mg_mgr_free(&mgr);
+	}
+	mg_iobuf_free(&stream);
+}
+
+// === Fragmented messages ===
+static void test_fragments_with_control_frames(void) {
+	struct mg_mgr mgr;
+	mg_mgr_init(&mgr);
+	struct mg_connection* c = new_conn(&mgr, MG_MAX_RECV_SIZE);
+	struct mg_iobuf stream = { NULL, 0, 0, 64 };
+	add_frame(&stream, WEBSOCKET_OP_TEXT, 0, "frag", 4);
+	add_frame(&stream, WEBSOCKET_OP_PING, 1, "p", 1);
+	add_frame(&stream, WEBSOCKET_OP_CONTINUE, 0, "men", 3);
+	add_frame(&stream, WEBSOCKET_OP_PONG, 1, "", 0);
+	add_frame(&stream, WEBSOCKET_OP_CONTINUE, 1, "ted", 3);
+	add_frame(&stream, WEBSOCKET_OP_BINARY, 0, "bi", 2);
+	add_frame(&stream, WEBSOCKET_OP_CONTINUE, 1, "n", 1);
+	feed(c, stream.buf, stream.len);
+
+	CHECK(delivered.count == 2, "fragments: %zu messages, expected 2", delivered.count);
+	CHECK(delivered_is(0, WEBSOCKET_OP_TEXT, "fragmented"), "fragments: first message wrong");
+	CHECK(delivered_is(1, WEBSOCKET_OP_BINARY, "bin"), "fragments: second message wrong");
+	CHECK(c->recv.len == 0, "fragments: %zu bytes left in recv", c->recv.len);
+	CHECK(!c->is_closing, "fragments: connection closed");
+	// The PING is answered even in the middle of a message.
+	CHECK(c->send.len == 3 && (c->send.buf[0] & 15) == WEBSOCKET_OP_PONG, "fragments: PING not answered");
+	// A small reassembly buffer is kept for the next message.
+	CHECK(c->wsmsg.size > 0 && c->wsmsg.len == 0, "fragments: wsmsg size %zu len %zu", c->wsmsg.size, c->wsmsg.len);
+
+	mg_iobuf_free(&stream);
+	free_conn(c);
+	mg_mgr_free(&mgr);
+}
+
+static void test_continuation_without_first_frame(void) {
+	struct mg_mgr mgr;
+	mg_mgr_init(&mgr);
+	struct mg_connection* c = new_conn(&mgr, MG_MAX_RECV_SIZE);
+	struct mg_iobuf stream = { NULL, 0, 0, 64 };
+	add_frame(&stream, WEBSOCKET_OP_CONTINUE, 1, "orphan", 6);
+	feed(c, stream.buf, stream.len);
+	CHECK(delivered.count == 0, "orphan continuation: %zu messages delivered", delivered.count);
+	CHECK(c->is_closing, "orphan continuation: connection left open");
+	mg_iobuf_free(&stream);
+	free_conn(c);
+	mg_mgr_free(&mgr);
+}
+
+// A message reassembled past max_recv fails the connection, even though
+// every fragment is small.
+static void test_message_over_max_recv(void) {
+	struct mg_mgr mgr;
+	mg_mgr_init(&mgr);
+	size_t limit = 64 * 1024;
+	struct mg_connection* c = new_conn(&mgr, limit);
+	static char chunk[1000];
+	memset(chunk, 'x', sizeof(chunk));
+	struct mg_iobuf stream = { NULL, 0, 0, 4096 };
+	for (size_t sent = 0, i = 0; sent <= limit; sent += sizeof(chunk), ++i)
+		add_frame(&stream, i ? WEBSOCKET_OP_CONTINUE : WEBSOCKET_OP_TEXT, 0, chunk, sizeof(chunk));
+	add_frame(&stream, WEBSOCKET_OP_CONTINUE, 1, chunk, sizeof(chunk));
+	// A few fragments per read, so recv itself never nears the limit.
+	for (size_t ofs = 0; ofs < stream.len && !c->is_closing; ofs += 4096)
+		feed(c, stream.buf + ofs, stream.len - ofs < 4096 ? stream.len - ofs : 4096);
+	CHECK(delivered.count == 0, "over max_recv: %zu messages delivered", delivered.count);
+	CHECK(c->is_closing, "over max_recv: connection left open");
+	mg_iobuf_free(&stream);
+	free_conn(c);
+	mg_mgr_free(&mgr);
+}
+
+// === Buffer release ===
+// A fragmented message and a single frame past MG_MAX_RECV_SIZE, followed
+// by the start of a small frame: both buffers must shrink once delivered,
+// without losing the partial frame.
+static void test_outsized_buffers_released(void) {
+	struct mg_mgr mgr;
+	mg_mgr_init(&mgr);
+	struct mg_connection* c = new_conn(&mgr, 64 * 1024 * 1024);
+	size_t fragment = MG_MAX_RECV_SIZE / 2 + 1;
+	char* big = malloc(MG_MAX_RECV_SIZE + 1);
+	memset(big, 'b', MG_MAX_RECV_SIZE + 1);
+	struct mg_iobuf stream = { NULL, 0, 0, 4096 };
+	add_frame(&stream, WEBSOCKET_OP_BINARY, 0, big, fragment);
+	add_frame(&stream, WEBSOCKET_OP_CONTINUE, 0, big, fragment);
+	add_frame(&stream, WEBSOCKET_OP_CONTINUE, 1, big, fragment);
+	add_frame(&stream, WEBSOCKET_OP_BINARY, 1, big, MG_MAX_RECV_SIZE + 1);
+	add_frame(&stream, WEBSOCKET_OP_TEXT, 1, "tail", 4);
+	size_t held_back = 3;
+	feed(c, stream.buf, stream.len - held_back);
+
+	CHECK(delivered.count == 2, "outsized: %zu messages, expected 2", delivered.count);
+	CHECK(delivered.count >= 2 && delivered.data[0].len == 3 * fragment && delivered.data[1].len == MG_MAX_RECV_SIZE + 1,
+		  "outsized: wrong message sizes");
+	CHECK(c->wsmsg.size == 0, "outsized: wsmsg kept %zu bytes", c->wsmsg.size);
+	CHECK(c->recv.size <= MG_MAX_RECV_SIZE, "outsized: recv kept %zu bytes", c->recv.size);
+	CHECK(c->recv.len == 6 - held_back, "outsized: partial frame lost, recv.len %zu", c->recv.len);
+
+	feed(c, stream.buf + stream.len - held_back, held_back);
+	CHECK(delivered_is(2, WEBSOCKET_OP_TEXT, "tail"), "outsized: frame after the big ones wrong");
+	CHECK(c->recv.len == 0, "outsized: %zu bytes left in recv", c->recv.len);
+
+	free(big);
+	mg_iobuf_free(&stream);
+	free_conn(c);
+	mg_mgr_free(&mgr);
+}
+
+// === Main ===
+int main(void) {
+	mg_log_set(MG_LL_NONE);
+	test_read_cursor();
+	test_fragments_with_control_frames();
+	test_continuation_without_first_frame();
+	test_message_over_max_recv();
+	test_outsized_buffers_released();
+	if (failures == 0)
+		printf("mg_ws_cb delivers and releases as expected\n");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,106 @@
+// Compares mg_ws_xor with a byte-by-byte reference over random lengths,
+// source and destination offsets, in place and with the mask stored right
+// before the data as ws_process leaves it. mg_ws_xor is static, so mongoose.c
+// is compiled into the test; CMake builds it once per masking path.
+
+// === Includes ===
+#include "mongoose.c"
+
+// === Helpers ===
+#define ITERATIONS 20000
+#define MAX_LEN 4096
+#define MAX_OFFSET 32
+
+// Exit code CTest reads as "skipped".
+#define SKIP_RETURN_CODE 77
+
+static uint32_t rng_state = 0x9e3779b9u;
+
+// xorshift32, so every run checks the same cases.
+static uint32_t next_random(void) {
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+static void reference_xor(uint8_t* dst, const uint8_t* src, size_t len, const uint8_t* mask) {
+	for (size_t i = 0; i < len; ++i)
+		dst[i] = (uint8_t)(src[i] ^ mask[i & 3]);
+}
+
+static const char* masking_path(void) {
+#if MG_WS_AVX2
+	return "AVX2";
+#elif MG_WS_SSE2
+	return "SSE2";
+#elif MG_WS_NEON
+	return "NEON";
+#else
+	return "words";
+#endif
+}
+
+// Returns false, after printing the case, when mg_ws_xor disagrees.
+static bool check_case(size_t len, size_t src_offset, size_t dst_offset) {
+	static uint8_t src[MAX_LEN + MAX_OFFSET], dst[MAX_LEN + MAX_OFFSET], expected[MAX_LEN];
+	static uint8_t framed[4 + MAX_LEN + MAX_OFFSET];
+	uint8_t mask[4];
+	for (size_t i = 0; i < len + src_offset; ++i)
+		src[i] = (uint8_t)next_random();
+	for (size_t i = 0; i < sizeof(mask); ++i)
+		mask[i] = (uint8_t)next_random();
+	reference_xor(expected, src + src_offset, len, mask);
+
+	// Copy, with a guard byte after the destination.
+	memset(dst, 0xa5, sizeof(dst));
+	mg_ws_xor(dst + dst_offset, src + src_offset, len, mask);
+	if (memcmp(dst + dst_offset, expected, len) != 0 || (dst_offset + len < sizeof(dst) && dst[dst_offset + len] != 0xa5)) {
+		printf("FAIL: copy, len %zu, src offset %zu, dst offset %zu\n", len, src_offset, dst_offset);
+		return false;
+	}
+
+	// In place.
+	mg_ws_xor(src + src_offset, src + src_offset, len, mask);
+	if (memcmp(src + src_offset, expected, len) != 0) {
+		printf("FAIL: in place, len %zu, offset %zu\n", len, src_offset);
+		return false;
+	}
+
+	// In place with the mask just before the payload, as in a received frame.
+	uint8_t* payload = framed + dst_offset + 4;
+	memcpy(payload - 4, mask, sizeof(mask));
+	reference_xor(payload, expected, len, mask);	// undo, to get the masked input back
+	mg_ws_xor(payload, payload, len, payload - 4);
+	if (memcmp(payload, expected, len) != 0) {
+		printf("FAIL: in place after the mask, len %zu, offset %zu\n", len, dst_offset);
+		return false;
+	}
+	return true;
+}
+
+// === Main ===
+int main(void) {
+#if MG_WS_AVX2 && (defined(__GNUC__) || defined(__clang__))
+	if (!__builtin_cpu_supports("avx2")) {
+		printf("SKIP: this CPU has no AVX2\n");
+		return SKIP_RETURN_CODE;
+	}
+#endif
+	// Every length around the vector and word block sizes, then random ones.
+	for (size_t len = 0; len <= 80; ++len) {
+		for (size_t offset = 0; offset < 8; ++offset) {
+			if (!check_case(len, offset, 7 - offset))
+				return 1;
+		}
+	}
+	for (int i = 0; i < ITERATIONS; ++i) {
+		size_t len = next_random() % (MAX_LEN + 1);
+		size_t src_offset = next_random() % MAX_OFFSET;
+		size_t dst_offset = next_random() % MAX_OFFSET;
+		if (!check_case(len, src_offset, dst_offset))
+			return 1;
+	}
+	printf("%s masking matches the reference\n", masking_path());
+	return 0;
+}